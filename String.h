@@ -10,6 +10,8 @@ public:
 
     String(const char *d) : data_(d), size_(64){}
 
+    String(const char *d, size_t n) : data_(d), size_(n){}
+
     const char *data() const { return data_; }
 
     size_t size() const { return size_; }
@@ -0,0 +1,378 @@
+#pragma once
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "direct_mapped_table.h"
+#include "new_hash_table.h"
+#include "robin_hood_hash_table.h"
+#include "small_hash_table.h"
+#include "string_hash_table.h"
+
+/// Table layouts AdaptiveHashTable chooses from. Each one also fixes the
+/// hasher: SMALL and DIRECT_MAPPED hash nothing, BY_LENGTH pads short
+/// String keys into integers and uses the murmur3 finalizer, integer and
+/// packed keys always use it, the other String layouts use XXHash32.
+enum class TableLayout : uint8_t {
+    SMALL,          /// SmallHashTable, tag scan over a few dozen inline keys
+    DIRECT_MAPPED,  /// IntegerKeyTable, direct mapped over a small integer key range
+    CHAINED,        /// BasicHashTable
+    INLINE_KEY,     /// BasicHashTable with InlineString<24> cells
+    BY_LENGTH,      /// StringHashTable, one sub-table per key length class
+    ROBIN_HOOD,     /// RobinHoodHashTable, linear probing
+};
+
+inline const char* layout_name(TableLayout layout) {
+    switch (layout) {
+    case TableLayout::SMALL: return "small";
+    case TableLayout::DIRECT_MAPPED: return "direct_mapped";
+    case TableLayout::CHAINED: return "chained";
+    case TableLayout::INLINE_KEY: return "inline_key";
+    case TableLayout::BY_LENGTH: return "by_length";
+    case TableLayout::ROBIN_HOOD: return "robin_hood";
+    }
+    return "unknown";
+}
+
+inline const char* hasher_name(TableLayout layout, bool string_key) {
+    switch (layout) {
+    case TableLayout::SMALL:
+    case TableLayout::DIRECT_MAPPED: return "none";
+    case TableLayout::BY_LENGTH: return "murmur3 on padded keys, xxhash32 past 24 bytes";
+    default: return string_key ? "xxhash32" : "murmur3";
+    }
+}
+
+/// What sample_build() saw of the build side.
+struct BuildSample {
+    size_t rows = 0;
+    /// rows looked at, evenly spaced over the build side
+    size_t sampled = 0;
+    /// distinct keys among the sampled rows, and those seen once and twice
+    size_t distinct = 0;
+    size_t singletons = 0;
+    size_t doubletons = 0;
+    /// String keys: sizes over the sample; fixed size keys: sizeof(Key)
+    double avg_key_bytes = 0;
+    size_t max_key_bytes = 0;
+    /// unsigned integer keys: exact bounds over all rows
+    uint64_t min_key = 0;
+    uint64_t max_key = 0;
+
+    /// distinct / sampled, 1 when every sampled key is unique
+    double distinct_ratio() const { return sampled ? double(distinct) / sampled : 1; }
+    /// RowRefs per key, sampled / distinct
+    double duplicate_factor() const { return distinct ? double(sampled) / distinct : 1; }
+    /// bias corrected Chao1 estimate of the distinct keys of all rows, from
+    /// the keys seen once and twice in the sample: many keys seen once mean
+    /// many keys the sample missed
+    size_t estimated_distinct() const {
+        if (sampled == rows) return distinct;
+        auto res = distinct + double(singletons) * (singletons - 1) / (2 * (doubletons + 1));
+        return std::min<double>(rows, res);
+    }
+};
+
+/// The layout chosen for a build side, with the sample it was chosen from.
+struct TableChoice {
+    BuildSample sample;
+    TableLayout layout = TableLayout::CHAINED;
+    /// initial degree, sized for the estimated distinct keys
+    uint32_t degree = 10;
+    bool string_key = false;
+    bool integer_key = false;
+    /// the rule that picked layout
+    const char* reason = "";
+
+    std::string describe() const {
+        char res[512];
+        snprintf(res, sizeof(res),
+                 "layout %s, hasher %s, degree %u (%s); rows %zu, sampled %zu, distinct %zu, "
+                 "distinct ratio %.3f, duplicate factor %.2f, estimated distinct %zu, key bytes avg %.1f max %zu",
+                 layout_name(layout), hasher_name(layout, string_key), degree, reason, sample.rows, sample.sampled,
+                 sample.distinct, sample.distinct_ratio(), sample.duplicate_factor(), sample.estimated_distinct(),
+                 sample.avg_key_bytes, sample.max_key_bytes);
+        if (integer_key) {
+            auto len = strlen(res);
+            snprintf(res + len, sizeof(res) - len, ", key range [%" PRIu64 ", %" PRIu64 "]", sample.min_key, sample.max_key);
+        }
+        return res;
+    }
+};
+
+/// Choice thresholds. The defaults come from main_adaptive.cpp.
+struct TableChoiceSettings {
+    size_t sample_size = 4096;
+    /// estimated distinct keys up to this use SMALL
+    size_t max_small = 32;
+    /// DIRECT_MAPPED while max - min of the keys is below this, and below
+    /// max_direct_slots_per_key slots per estimated distinct key
+    uint64_t max_direct_range = IntegerKeyTable<uint64_t>::DEFAULT_MAX_DIRECT_RANGE;
+    uint64_t max_direct_slots_per_key = IntegerKeyTable<uint64_t>::DEFAULT_MAX_DIRECT_SLOTS_PER_KEY;
+    /// INLINE_KEY when no sampled String key is longer than this, so every
+    /// compare stays inside the cell
+    size_t max_inline_bytes = 24;
+    /// BY_LENGTH and ROBIN_HOOD are off by default, in main_adaptive.cpp
+    /// neither beat CHAINED or INLINE_KEY on the key shapes they target
+    bool allow_by_length = false;
+    size_t max_by_length_bytes = 24;
+    bool allow_robin_hood = false;
+    double min_robin_hood_distinct_ratio = 0.9;
+};
+
+/// Look at settings.sample_size evenly spaced build keys; integer key
+/// bounds are taken over all rows, as DIRECT_MAPPED must hold every key.
+template <typename Key>
+BuildSample sample_build(const Key* keys, size_t rows, const TableChoiceSettings &settings = {}) {
+    BuildSample res;
+    res.rows = rows;
+    res.sampled = std::min(rows, settings.sample_size);
+    /// the sample is counted with the table it is about, positions are dense
+    BasicHashTable<Key> counter(10);
+    std::vector<uint32_t> counts;
+    size_t key_bytes = 0;
+    for (size_t i = 0; i < res.sampled; ++i) {
+        auto &key = keys[i * rows / res.sampled];
+        auto place_value = counter.find(key);
+        if (place_value) {
+            ++counts[place_value - 1];
+        } else {
+            counter.insert(key, RowRef(i, 0));
+            counts.push_back(1);
+        }
+        if constexpr (std::is_same<Key, String>::value) {
+            key_bytes += key.size();
+            res.max_key_bytes = std::max(res.max_key_bytes, key.size());
+        }
+    }
+    res.distinct = counts.size();
+    res.singletons = std::count(counts.begin(), counts.end(), 1);
+    res.doubletons = std::count(counts.begin(), counts.end(), 2);
+    if constexpr (std::is_same<Key, String>::value) {
+        res.avg_key_bytes = res.sampled ? double(key_bytes) / res.sampled : 0;
+    } else {
+        res.avg_key_bytes = res.max_key_bytes = sizeof(Key);
+    }
+    if constexpr (std::is_unsigned<Key>::value) {
+        if (rows) {
+            res.min_key = res.max_key = keys[0];
+            for (size_t i = 1; i < rows; ++i) {
+                res.min_key = std::min<uint64_t>(res.min_key, keys[i]);
+                res.max_key = std::max<uint64_t>(res.max_key, keys[i]);
+            }
+        }
+    }
+    return res;
+}
+
+/// Pick a layout for the sampled build side. The rules are checked in order:
+/// few keys go to SMALL, a dense integer range to DIRECT_MAPPED, short
+/// String keys to BY_LENGTH when allowed or else INLINE_KEY, mostly unique
+/// String keys to ROBIN_HOOD when allowed; everything else to CHAINED.
+template <typename Key>
+TableChoice choose_table(const BuildSample &sample, const TableChoiceSettings &settings = {}) {
+    TableChoice res;
+    res.sample = sample;
+    res.string_key = std::is_same<Key, String>::value;
+    res.integer_key = std::is_unsigned<Key>::value;
+    auto estimated_distinct = sample.estimated_distinct();
+    while (res.degree < 30 && (size_t(1) << res.degree) < estimated_distinct) {
+        ++res.degree;
+    }
+    if (estimated_distinct <= settings.max_small) {
+        res.layout = TableLayout::SMALL;
+        res.reason = "few distinct keys";
+        return res;
+    }
+    if constexpr (std::is_unsigned<Key>::value) {
+        auto range = sample.max_key - sample.min_key;
+        if (direct_mapping_pays(range, estimated_distinct, settings.max_direct_range,
+                                settings.max_direct_slots_per_key)) {
+            res.layout = TableLayout::DIRECT_MAPPED;
+            res.reason = "dense key range";
+            return res;
+        }
+    }
+    if constexpr (std::is_same<Key, String>::value) {
+        if (settings.allow_by_length && sample.max_key_bytes <= settings.max_by_length_bytes) {
+            res.layout = TableLayout::BY_LENGTH;
+            res.reason = "short keys";
+            return res;
+        }
+        if (sample.max_key_bytes <= settings.max_inline_bytes) {
+            res.layout = TableLayout::INLINE_KEY;
+            res.reason = "keys fit in the cell";
+            return res;
+        }
+        if (settings.allow_robin_hood && sample.distinct_ratio() >= settings.min_robin_hood_distinct_ratio) {
+            res.layout = TableLayout::ROBIN_HOOD;
+            res.reason = "unique keys";
+            return res;
+        }
+        res.reason = "long keys";
+        return res;
+    }
+    res.reason = "default";
+    return res;
+}
+
+/// Join table that samples its build side and picks one of the layouts
+/// above, then behaves like HashTable: find() returns position + 1 and 0
+/// when not found, get(pos) takes find() - 1. choice() tells what was picked
+/// and why. The build keys passed to the constructor are only sampled, they
+/// are inserted as usual.
+template <typename Key>
+class AdaptiveHashTable {
+public:
+    using key_t = Key;
+
+    AdaptiveHashTable(const Key* build_keys, size_t rows, const TableChoiceSettings &settings = {})
+            : AdaptiveHashTable(choose_table<Key>(sample_build(build_keys, rows, settings), settings)) {}
+
+    /// build the layout of an existing choice, e.g. one with layout overridden
+    explicit AdaptiveHashTable(const TableChoice &choice_) : m_choice(choice_) {
+        auto degree = m_choice.degree;
+        switch (m_choice.layout) {
+        case TableLayout::SMALL: small = new SmallHashTable<Key>(degree); return;
+        case TableLayout::INLINE_KEY:
+            if constexpr (std::is_same<Key, String>::value) {
+                inline_key = new InlineKeyHashTable(degree);
+                return;
+            }
+            break;
+        case TableLayout::BY_LENGTH:
+            if constexpr (std::is_same<Key, String>::value) {
+                by_length = new StringHashTable(degree);
+                return;
+            }
+            break;
+        case TableLayout::ROBIN_HOOD:
+            if constexpr (std::is_same<Key, String>::value) {
+                robin_hood = new RobinHoodHashTable(degree);
+                return;
+            }
+            break;
+        case TableLayout::DIRECT_MAPPED:
+            /// position + 1 of the last key must fit index_t, and the slots
+            /// memory; keys outside the sampled range convert the table to a
+            /// hashed one
+            if constexpr (std::is_unsigned<Key>::value) {
+                auto range = m_choice.sample.max_key - m_choice.sample.min_key;
+                if (range < std::numeric_limits<index_t>::max() && range < DirectMappedTable<Key>::MAX_RANGE) {
+                    direct = new IntegerKeyTable<Key>(m_choice.sample.min_key, m_choice.sample.max_key);
+                    return;
+                }
+            }
+            break;
+        case TableLayout::CHAINED: break;
+        }
+        /// layouts that do not apply to Key fall back to CHAINED
+        m_choice.layout = TableLayout::CHAINED;
+        chained = new BasicHashTable<Key>(degree);
+    }
+    AdaptiveHashTable(const AdaptiveHashTable&) = delete;
+    AdaptiveHashTable& operator=(const AdaptiveHashTable&) = delete;
+    ~AdaptiveHashTable() {
+        delete small;
+        delete direct;
+        delete chained;
+        delete inline_key;
+        delete by_length;
+        delete robin_hood;
+    }
+
+    const TableChoice& choice() const { return m_choice; }
+
+    void insert(const key_t &key, RowRef && value) {
+        visit([&](auto &table) { table.insert(key, std::move(value)); });
+    }
+
+    /// insert with block
+    void m_insert(key_t* keys, RowRef* values, unsigned int block_size) {
+        visit([&](auto &table) {
+            if constexpr (is_robin_hood<decltype(table)>) {
+                for (uint32_t i = 0; i < block_size; ++i) {
+                    table.insert(keys[i], std::move(values[i]));
+                }
+            } else {
+                table.m_insert(keys, values, block_size);
+            }
+        });
+    }
+
+    index_t find(const key_t &key) {
+        return visit([&](auto &table) {
+            if constexpr (is_robin_hood<decltype(table)>) {
+                /// RobinHoodHashTable returns the position itself, EMPTY when not found
+                auto place_value = table.find(key);
+                return place_value == RobinHoodHashTable::EMPTY ? 0 : index_t(place_value) + 1;
+            } else {
+                return index_t(table.find(key));
+            }
+        });
+    }
+
+    /// find with block
+    index_t* m_find(key_t* keys, uint32_t block_size) {
+        return visit([&](auto &table) {
+            if constexpr (is_robin_hood<decltype(table)>) {
+                auto* res = new index_t[block_size];
+                for (uint32_t i = 0; i < block_size; ++i) {
+                    auto place_value = table.find(keys[i]);
+                    res[i] = place_value == RobinHoodHashTable::EMPTY ? 0 : index_t(place_value) + 1;
+                }
+                return res;
+            } else {
+                return table.m_find(keys, block_size);
+            }
+        });
+    }
+
+    RowRefList* get(index_t pos) {
+        return visit([&](auto &table) { return table.get(pos); });
+    }
+
+    index_t size() const {
+        return visit([](auto &table) { return index_t(table.size()); });
+    }
+
+private:
+    template <typename T>
+    static constexpr bool is_robin_hood = std::is_same<std::decay_t<T>, RobinHoodHashTable>::value;
+
+    /// call func with the table of the chosen layout, const when self is
+    template <typename Self, typename Func>
+    static decltype(auto) visit(Self &self, Func && func) {
+        if constexpr (std::is_same<Key, String>::value) {
+            if (self.inline_key) return func(*self.inline_key);
+            if (self.by_length) return func(*self.by_length);
+            if (self.robin_hood) return func(*self.robin_hood);
+        }
+        if constexpr (std::is_unsigned<Key>::value) {
+            if (self.direct) return func(*self.direct);
+        }
+        if (self.small) return func(*self.small);
+        return func(*self.chained);
+    }
+
+    template <typename Func>
+    decltype(auto) visit(Func && func) { return visit(*this, func); }
+
+    template <typename Func>
+    decltype(auto) visit(Func && func) const { return visit(*this, func); }
+
+    TableChoice m_choice;
+    SmallHashTable<Key>* small = nullptr;
+    IntegerKeyTable<std::conditional_t<std::is_unsigned<Key>::value, Key, uint64_t>>* direct = nullptr;
+    BasicHashTable<Key>* chained = nullptr;
+    InlineKeyHashTable* inline_key = nullptr;
+    StringHashTable* by_length = nullptr;
+    RobinHoodHashTable* robin_hood = nullptr;
+};
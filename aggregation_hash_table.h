@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include "arena.h"
+#include "column_view.h"
+#include "new_hash_table.h"
+
+/// GROUP BY on the chained table: each key maps to a State allocated in an
+/// arena the first time the key is seen. Cells only hold the State pointer,
+/// so states never move when buf grows.
+///
+/// Every row probes the table, so the table is grown at half load rather
+/// than when buf is full: at load 1 the chain walk mispredicts often enough
+/// to double the cost per row of a table that fits in cache.
+template <typename Key, typename State, typename CellKey = Key>
+class AggregationHashTable {
+public:
+    using key_t = Key;
+    using Impl = BasicHashTable<Key, CellKey, HeapAllocator, State*>;
+    /// grow once size * MAX_LOAD_INVERSE reaches buf_size
+    static constexpr uint32_t MAX_LOAD_INVERSE = 2;
+
+    AggregationHashTable(uint32_t degree_size) : impl(degree_size) {}
+    ~AggregationHashTable() {
+        if constexpr (!std::is_trivially_destructible<State>::value) {
+            for (auto &cell : impl) {
+                cell.second->~State();
+            }
+        }
+    }
+
+    /// state of key, value initialized on first use
+    State* emplace(const key_t &key) {
+        auto [place_value, inserted] = impl.emplace(key);
+        auto state = impl.get(place_value - 1);
+        if (inserted) {
+            auto res = *state = new (arena.alloc(sizeof(State), alignof(State))) State();
+            if (size_t(impl.size()) * MAX_LOAD_INVERSE >= impl.buf_size()) {
+                impl.resize();
+            }
+            return res;
+        }
+        return *state;
+    }
+
+    /// emplace with block, states[i] is the state of keys[i]
+    void m_emplace(key_t* keys, uint32_t block_size, State** states) {
+        m_emplace_column(keys, 0, block_size, states);
+    }
+
+    /// emplace rows [begin, begin + block_size) of a key column
+    template <typename Column>
+    void m_emplace_column(const Column &column, size_t begin, uint32_t block_size, State** states) {
+        for (uint32_t i = 0; i < block_size; ++i) {
+            states[i] = emplace(column_key(column, begin + i));
+        }
+    }
+
+    /// state of key, nullptr if the key was never emplaced
+    State* find(const key_t &key) {
+        auto place_value = impl.find(key);
+        return place_value ? *impl.get(place_value - 1) : nullptr;
+    }
+
+    /// calls func(key, state) for every group in insertion order, walking buf densely
+    template <typename Func>
+    void finalize(Func && func) {
+        for (auto &cell : impl) {
+            func(cell.first, *cell.second);
+        }
+    }
+
+    index_t size() const { return impl.size(); }
+    size_t allocated_bytes() const { return arena.allocated_bytes(); }
+
+private:
+    Impl impl;
+    Arena arena;
+};
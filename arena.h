@@ -0,0 +1,54 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+/// Bump allocator for memory owned by a table: copied keys, aggregate states.
+/// Chunks double up to MAX_CHUNK_SIZE and are only freed with the arena.
+class Arena {
+public:
+    static constexpr size_t MIN_CHUNK_SIZE = 4096;
+    static constexpr size_t MAX_CHUNK_SIZE = 128 << 20;
+
+    Arena() {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+    ~Arena() {
+        for (auto chunk : chunks) {
+            delete[] chunk;
+        }
+    }
+
+    char* alloc(size_t size, size_t align = alignof(std::max_align_t)) {
+        auto pos = (used + align - 1) & ~(align - 1);
+        if (chunks.empty() || pos + size > chunk_size) {
+            add_chunk(size + align);
+            pos = (used + align - 1) & ~(align - 1);
+        }
+        used = pos + size;
+        return chunks.back() + pos;
+    }
+
+    /// copy size bytes of data into the arena
+    char* insert(const char* data, size_t size) {
+        auto res = alloc(size, 1);
+        memcpy(res, data, size);
+        return res;
+    }
+
+    size_t allocated_bytes() const { return allocated; }
+
+private:
+    void add_chunk(size_t min_size) {
+        chunk_size = std::max(std::min(chunk_size * 2, MAX_CHUNK_SIZE), min_size);
+        chunks.push_back(new char[chunk_size]);
+        allocated += chunk_size;
+        used = 0;
+    }
+
+    std::vector<char*> chunks;
+    size_t chunk_size = MIN_CHUNK_SIZE / 2;
+    size_t used = 0;
+    size_t allocated = 0;
+};
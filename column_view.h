@@ -0,0 +1,32 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "String.h"
+
+/// Views over the engine's key columns, the table reads keys straight from
+/// them instead of per-row String objects. The memory stays owned by the
+/// caller and, as with String keys, must outlive the table.
+
+/// Column of fixed width values, null_map[i] != 0 marks a NULL row.
+/// null_map is nullptr for not nullable columns.
+struct FixedColumn {
+    const char* data;
+    uint8_t width;
+    const uint8_t* null_map = nullptr;
+};
+
+/// Variable length values, row i is chars[offsets[i], offsets[i + 1]).
+struct StringColumn {
+    const char* chars;
+    const uint32_t* offsets;
+};
+
+inline String column_key(const StringColumn &column, size_t row) {
+    return String(column.chars + column.offsets[row], column.offsets[row + 1] - column.offsets[row]);
+}
+
+/// a plain array is a column of keys, for fixed size keys and String arrays
+template <typename T>
+inline const T &column_key(const T* column, size_t row) {
+    return column[row];
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include "epoch.h"
+#include "new_hash_table.h"
+
+/// Chained table for one writer that keeps inserting while many threads
+/// read, without locks on either side.
+///
+/// buf/first/next of one size form a Version, published through an atomic
+/// pointer. The writer links a new cell by writing it and its next[] entry
+/// before storing first[bucket] with release, so a reader that sees the
+/// link also sees the cell. resize() copies buf into a new Version (cells
+/// keep their positions), publishes it and retires the old one through
+/// EpochManager, which frees it once no reader can still be walking it.
+/// The writer checks for such versions after every block, and reclaim()
+/// frees the last ones once inserts have stopped.
+///
+/// Readers see each key and its first RowRef. More RowRefs of the same key
+/// are appended to its list without synchronization, read the whole list
+/// with get() only once inserts have stopped.
+template <typename Key, typename CellKey = Key>
+class ConcurrentHashTable {
+public:
+    using key_t = Key;
+    using Cell = std::pair<CellKey, RowRefList>;
+
+    /// a reader thread's handle, one per thread
+    class Reader {
+    public:
+        explicit Reader(ConcurrentHashTable &table_) : table(table_), slot(table_.epochs.register_reader()) {}
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        ~Reader() {
+            if (valid()) table.epochs.unregister_reader(slot);
+        }
+
+        /// false when EpochManager::MAX_READERS readers already exist
+        bool valid() const { return slot < EpochManager::MAX_READERS; }
+
+        /// position + 1, 0 when not found; positions stay valid across resizes
+        uint32_t find(const key_t &key) {
+            table.epochs.enter(slot);
+            auto res = table.find(table.version.load(), key, hash_key(key));
+            table.epochs.exit(slot);
+            return res;
+        }
+
+        /// find with block, the whole block is read in one epoch
+        uint32_t* m_find(key_t* keys, uint32_t block_size) {
+            auto* res = new uint32_t[block_size];
+            table.epochs.enter(slot);
+            auto current = table.version.load();
+            for (uint32_t i = 0; i < block_size; ++i) {
+                res[i] = table.find(current, keys[i], hash_key(keys[i]));
+            }
+            table.epochs.exit(slot);
+            return res;
+        }
+
+        /// the first RowRef of get(pos), pos is find() - 1 as usual
+        RowRef first_row(uint32_t pos) {
+            table.epochs.enter(slot);
+            auto &row_refs = table.version.load()->buf[pos].second;
+            RowRef res(row_refs.row_num, row_refs.block_offset);
+            table.epochs.exit(slot);
+            return res;
+        }
+
+    private:
+        ConcurrentHashTable &table;
+        uint32_t slot;
+    };
+
+    ConcurrentHashTable(uint32_t degree_size) {
+        version.store(new Version(degree_size));
+    }
+    ConcurrentHashTable(const ConcurrentHashTable&) = delete;
+    ConcurrentHashTable& operator=(const ConcurrentHashTable&) = delete;
+    ~ConcurrentHashTable() {
+        auto current = version.load();
+        for (uint32_t i = 0; i < m_size; ++i) {
+            current->buf[i].second.clear();
+        }
+        delete current;
+    }
+
+    /// writer only
+    void insert(const key_t &key, RowRef && value) {
+        auto current = version.load(std::memory_order_relaxed);
+        auto hash_value = hash_key(key);
+        auto place_value = find(current, key, hash_value);
+        if (place_value) {
+            current->buf[place_value - 1].second.insert(std::move(value));
+            return;
+        }
+        auto bucket_value = hash_value & current->mask();
+        new (&current->buf[m_size]) Cell(key, RowRefList(value.row_num, value.block_offset));
+        ++m_size;
+        current->next[m_size].store(current->first[bucket_value].load(std::memory_order_relaxed),
+                                    std::memory_order_relaxed);
+        current->first[bucket_value].store(m_size, std::memory_order_release);
+        if (m_size >= current->buf_size()) {
+            resize();
+        }
+    }
+
+    /// insert with block, writer only
+    void m_insert(key_t* keys, RowRef* values, unsigned int block_size) {
+        for (uint32_t i = 0; i < block_size; ++i) {
+            insert(keys[i], std::move(values[i]));
+        }
+        reclaim();
+    }
+
+    /// writer only: free the retired versions no reader can still see
+    void reclaim() {
+        if (epochs.retired_size()) epochs.reclaim();
+    }
+
+    /// writer only, or any thread once inserts have stopped
+    uint32_t find(const key_t &key) {
+        return find(version.load(), key, hash_key(key));
+    }
+
+    /// writer only, or any thread once inserts have stopped
+    RowRefList* get(uint32_t pos) {
+        return &version.load()->buf[pos].second;
+    }
+
+    uint32_t size() const { return m_size; }
+
+    /// old versions not yet freed, they wait for readers that may see them
+    size_t retired_size() const { return epochs.retired_size(); }
+
+private:
+    struct Version {
+        uint32_t degree;
+        Cell* buf;
+        std::atomic<uint32_t>* first;
+        std::atomic<uint32_t>* next;
+
+        explicit Version(uint32_t degree_) : degree(degree_) {
+            buf = static_cast<Cell*>(HeapAllocator::alloc(sizeof(Cell) * buf_size()));
+            first = new std::atomic<uint32_t>[buf_size()]();
+            next = new std::atomic<uint32_t>[buf_size() + 1]();
+        }
+        /// frees the arrays only, the RowRefList batches belong to the newest version
+        ~Version() {
+            HeapAllocator::free(buf, sizeof(Cell) * buf_size());
+            delete[] first;
+            delete[] next;
+        }
+
+        uint32_t buf_size() const { return 1 << degree; }
+        uint32_t mask() const { return buf_size() - 1; }
+    };
+
+    uint32_t find(Version* current, const key_t &key, uint32_t hash_value) {
+        auto place_value = current->first[hash_value & current->mask()].load(std::memory_order_acquire);
+        while (place_value && current->buf[place_value - 1].first != key) {
+            place_value = current->next[place_value].load(std::memory_order_relaxed);
+        }
+        return place_value;
+    }
+
+    /// build the next version beside the current one, readers keep using
+    /// the current one until the new one is published
+    void resize() {
+        auto current = version.load(std::memory_order_relaxed);
+        auto res = new Version(current->degree + (current->degree > 23 ? 1 : 2));
+        memcpy(static_cast<void*>(res->buf), current->buf, sizeof(Cell) * m_size);
+        for (uint32_t i = 0; i < m_size; ++i) {
+            auto bucket_value = hash_key(res->buf[i].first) & res->mask();
+            res->next[i + 1].store(res->first[bucket_value].load(std::memory_order_relaxed),
+                                   std::memory_order_relaxed);
+            res->first[bucket_value].store(i + 1, std::memory_order_relaxed);
+        }
+        version.store(res);
+        epochs.retire([current] { delete current; });
+    }
+
+    std::atomic<Version*> version;
+    uint32_t m_size = 0;
+    EpochManager epochs;
+};
@@ -0,0 +1,217 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "new_hash_table.h"
+
+/// Bucketized cuckoo hashing.
+/// A key lives in one of two buckets of 8 slots. A bucket is one cache line
+/// holding an 8 bit tag and a buf index per slot. The buckets only bound the
+/// index lines: a miss reads at most the two bucket lines, a hit adds the
+/// cell line (and the key bytes of String keys), as do false tag matches
+/// (same 8 bit tag, 1/256 per occupied slot). Cells stay dense in buf as in
+/// HashTable, find() returns position + 1 and 0 when not found.
+///
+/// The second bucket is bucket ^ f(tag), so a resident can be moved to its
+/// other bucket without rehashing its key. f(tag) is odd, so the two buckets
+/// always differ once there are two.
+template <typename Key, typename CellKey = Key>
+class CuckooHashTable {
+public:
+    using key_t = Key;
+    using Cell = std::pair<CellKey, RowRefList>;
+    static constexpr uint32_t SLOTS = 8;
+    static constexpr uint32_t MAX_KICKS = 256;
+
+    struct alignas(64) Bucket {
+        uint8_t tags[SLOTS];
+        uint32_t cells[SLOTS];
+    };
+
+    /// 2^degree_size slots
+    CuckooHashTable(uint32_t degree_size, double max_load_factor_ = 0.9)
+            : degree(degree_size > 3 ? degree_size - 3 : 0), max_load_factor(max_load_factor_) {
+        buckets = new Bucket[bucket_size()]();
+        buf = static_cast<Cell*>(HeapAllocator::alloc(sizeof(Cell) * capacity()));
+    }
+    ~CuckooHashTable() {
+        for (uint32_t i = 0; i < m_size; ++i) {
+            buf[i].second.clear();
+        }
+        delete[] buckets;
+        HeapAllocator::free(buf, sizeof(Cell) * capacity());
+    }
+
+    void insert(const key_t &key, RowRef && value) {
+        auto hash_value = hash(key);
+        auto place_value = find(key, hash_value);
+        if (place_value) {
+            buf[place_value - 1].second.insert(std::move(value));
+            return;
+        }
+        if (m_size >= capacity() * max_load_factor) {
+            resize();
+        }
+        new (&buf[m_size]) Cell(key, RowRefList(value.row_num, value.block_offset));
+        ++m_size;
+        if (!place(tag(hash_value), hash_value & mask(), m_size - 1)) {
+            /// the cell is already in buf, rebuilding the buckets places it
+            resize();
+        }
+    }
+
+    /// insert with block
+    void m_insert(key_t* keys, RowRef* values, unsigned int block_size) {
+        for (uint32_t i = 0; i < block_size; ++i) {
+            insert(keys[i], std::move(values[i]));
+        }
+    }
+
+    uint32_t find(const key_t &key) {
+        return find(key, hash(key));
+    }
+
+    /// precomputed hash, same contract as BasicHashTable
+    uint32_t find(const key_t &key, uint32_t hash_value) {
+        auto tag_value = tag(hash_value);
+        auto bucket_value = hash_value & mask();
+        auto res = find_in_bucket(key, tag_value, bucket_value);
+        if (res) return res;
+        return find_in_bucket(key, tag_value, alt_bucket(bucket_value, tag_value));
+    }
+
+    /// find with block, both buckets of every key are prefetched before probing
+    uint32_t* m_find(key_t* keys, uint32_t block_size) {
+        auto* res = new uint32_t[block_size];
+        std::vector<uint32_t> hash_values(block_size);
+        for (uint32_t i = 0; i < block_size; ++i) {
+            hash_values[i] = hash(keys[i]);
+            auto bucket_value = hash_values[i] & mask();
+            __builtin_prefetch(&buckets[bucket_value]);
+            __builtin_prefetch(&buckets[alt_bucket(bucket_value, tag(hash_values[i]))]);
+        }
+        for (uint32_t i = 0; i < block_size; ++i) {
+            res[i] = find(keys[i], hash_values[i]);
+        }
+        return res;
+    }
+
+    RowRefList* get(uint32_t pos) {
+        return &buf[pos].second;
+    }
+
+    uint32_t size() const { return m_size; }
+    uint32_t next_num() const { return collision_num; }
+    uint32_t capacity() const { return bucket_size() * SLOTS; }
+    uint32_t bucket_size() const { return 1 << degree; }
+    uint32_t mask() const { return bucket_size() - 1; }
+
+    template <typename T>
+    uint32_t hash(const T &key) const {
+        return hash_key(key);
+    }
+
+private:
+    /// top 8 bits of the hash, 0 marks an empty slot
+    static uint8_t tag(uint32_t hash_value) {
+        uint8_t res = hash_value >> 24;
+        return res ? res : 1;
+    }
+
+    uint32_t alt_bucket(uint32_t bucket_value, uint8_t tag_value) const {
+        return (bucket_value ^ ((tag_value * 0x5bd1e995u) | 1)) & mask();
+    }
+
+    /// bit i set when slot i may hold tag_value
+    static uint32_t match_tags(const Bucket &bucket, uint8_t tag_value) {
+#if defined(__SSE2__)
+        auto tags = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(bucket.tags));
+        auto eq = _mm_cmpeq_epi8(tags, _mm_set1_epi8(tag_value));
+        return _mm_movemask_epi8(eq) & 0xff;
+#else
+        /// SWAR zero byte test, may report extra slots above a real match
+        uint64_t tags;
+        memcpy(&tags, bucket.tags, sizeof(tags));
+        auto x = tags ^ (0x0101010101010101ULL * tag_value);
+        auto zero = (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+        uint32_t res = 0;
+        for (uint32_t i = 0; i < SLOTS; ++i) {
+            res |= ((zero >> (i * 8 + 7)) & 1) << i;
+        }
+        return res;
+#endif
+    }
+
+    uint32_t find_in_bucket(const key_t &key, uint8_t tag_value, uint32_t bucket_value) {
+        auto &bucket = buckets[bucket_value];
+        for (auto matches = match_tags(bucket, tag_value); matches; matches &= matches - 1) {
+            auto slot = __builtin_ctz(matches);
+            if (buf[bucket.cells[slot]].first == key) {
+                return bucket.cells[slot] + 1;
+            }
+            ++collision_num;
+        }
+        return 0;
+    }
+
+    bool try_place(uint8_t tag_value, uint32_t bucket_value, uint32_t cell) {
+        auto &bucket = buckets[bucket_value];
+        auto empty = match_tags(bucket, 0);
+        for (; empty; empty &= empty - 1) {
+            auto slot = __builtin_ctz(empty);
+            if (!bucket.tags[slot]) {
+                bucket.tags[slot] = tag_value;
+                bucket.cells[slot] = cell;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// put cell into one of its buckets, kicking residents to their other
+    /// bucket. On failure the last kicked entry is left out of the buckets,
+    /// its cell is still in buf.
+    bool place(uint8_t tag_value, uint32_t bucket_value, uint32_t cell) {
+        if (try_place(tag_value, bucket_value, cell)) return true;
+        bucket_value = alt_bucket(bucket_value, tag_value);
+        for (uint32_t kick = 0; kick < MAX_KICKS; ++kick) {
+            if (try_place(tag_value, bucket_value, cell)) return true;
+            auto slot = (cell + kick) % SLOTS;
+            auto &bucket = buckets[bucket_value];
+            std::swap(tag_value, bucket.tags[slot]);
+            std::swap(cell, bucket.cells[slot]);
+            bucket_value = alt_bucket(bucket_value, tag_value);
+        }
+        return false;
+    }
+
+    /// double the buckets and place every cell of buf again
+    void resize() {
+        auto old_capacity = capacity();
+        do {
+            ++degree;
+            delete[] buckets;
+            buckets = new Bucket[bucket_size()]();
+        } while (!rebuild());
+        buf = static_cast<Cell*>(HeapAllocator::realloc(buf, sizeof(Cell) * old_capacity, sizeof(Cell) * capacity()));
+    }
+
+    bool rebuild() {
+        for (uint32_t i = 0; i < m_size; ++i) {
+            auto hash_value = hash(buf[i].first);
+            if (!place(tag(hash_value), hash_value & mask(), i)) return false;
+        }
+        return true;
+    }
+
+    uint32_t degree;
+    uint32_t m_size = 0;
+    double max_load_factor;
+    Bucket* buckets;
+    Cell* buf;
+    uint32_t collision_num{0};
+};
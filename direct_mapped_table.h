@@ -0,0 +1,216 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "new_hash_table.h"
+
+/// Whether a key range is worth a direct mapped table: max - min below
+/// max_range, and at most max_slots_per_key slots per (distinct) key.
+inline bool direct_mapping_pays(uint64_t range, uint64_t keys, uint64_t max_range, uint64_t max_slots_per_key) {
+    return range < max_range && range / max_slots_per_key < keys;
+}
+
+/// Direct addressed table for integer keys from a small range.
+/// The RowRefList of key lives at buf[key - min_key], nothing is hashed or
+/// chained. find() follows HashTable: position + 1, 0 when not found.
+/// Inserting a key outside [min_key, max_key] throws std::out_of_range.
+template <typename Key>
+class DirectMappedTable {
+    static_assert(std::is_unsigned<Key>::value, "direct mapping needs unsigned integer keys");
+public:
+    using key_t = Key;
+    /// slots a table may have at most; the slots alone take 96GB there
+    static constexpr uint64_t MAX_RANGE = uint64_t(1) << 32;
+
+    /// whole domain, for UInt8/UInt16 keys
+    DirectMappedTable() : DirectMappedTable(0, std::numeric_limits<Key>::max()) {
+        static_assert(sizeof(Key) <= 2, "the whole domain of wider keys does not fit in memory");
+    }
+
+    DirectMappedTable(Key min_key_, Key max_key_) : min_key(min_key_) {
+        if (min_key_ > max_key_) throw std::invalid_argument("DirectMappedTable: min_key > max_key");
+        range = uint64_t(max_key_) - min_key_ + 1;
+        /// the whole uint64 domain wraps to 0
+        if (!range || range > MAX_RANGE) throw std::length_error("DirectMappedTable: key range does not fit in memory");
+        buf = new RowRefList[range];
+        used = new uint8_t[range]();
+    }
+    DirectMappedTable(const DirectMappedTable&) = delete;
+    DirectMappedTable& operator=(const DirectMappedTable&) = delete;
+    ~DirectMappedTable() {
+        for (uint64_t i = 0; i < range; ++i) {
+            if (used[i]) buf[i].clear();
+        }
+        delete[] buf;
+        delete[] used;
+    }
+
+    void insert(Key key, RowRef && value) {
+        auto pos = place(key);
+        if (pos >= range) throw std::out_of_range("DirectMappedTable: key outside [min_key, max_key]");
+        if (used[pos]) {
+            buf[pos].insert(std::move(value));
+            return;
+        }
+        new (&buf[pos]) RowRefList(value.row_num, value.block_offset);
+        used[pos] = 1;
+        ++m_size;
+    }
+
+    /// insert with block
+    void m_insert(const Key* keys, RowRef* values, unsigned int block_size) {
+        for (uint32_t i = 0; i < block_size; ++i) {
+            insert(keys[i], std::move(values[i]));
+        }
+    }
+
+    index_t find(Key key) const {
+        auto pos = place(key);
+        if (pos >= range || !used[pos]) return 0;
+        return pos + 1;
+    }
+
+    /// find with block
+    index_t* m_find(const Key* keys, uint32_t block_size) const {
+        auto* res = new index_t[block_size];
+        for (uint32_t i = 0; i < block_size; ++i) {
+            res[i] = find(keys[i]);
+        }
+        return res;
+    }
+
+    RowRefList* get(index_t pos) {
+        return &buf[pos];
+    }
+
+    index_t size() const { return m_size; }
+    uint32_t next_num() const { return 0; }
+
+    bool in_range(Key key) const { return place(key) < range; }
+
+    /// calls func(key, row_refs) for every key, in key order
+    template <typename Func>
+    void for_each(Func && func) {
+        for (uint64_t i = 0; i < range; ++i) {
+            if (used[i]) func(Key(min_key + i), buf[i]);
+        }
+    }
+
+    /// forget all keys without freeing their batches, once they moved to another table
+    void release_cells() {
+        std::fill(used, used + range, 0);
+        m_size = 0;
+    }
+
+private:
+    /// keys below min_key wrap around to a huge value and fail the range check
+    uint64_t place(Key key) const { return uint64_t(Key(key - min_key)); }
+
+    Key min_key;
+    uint64_t range;
+    index_t m_size = 0;
+    RowRefList* buf;
+    uint8_t* used;
+};
+
+/// Integer key table that looks at the build side before choosing a layout:
+/// DirectMappedTable when the build keys pass direct_mapping_pays(), the
+/// chained BasicHashTable otherwise. A key inserted later outside the build
+/// keys' range converts the table to BasicHashTable; positions from find()
+/// are not valid across the conversion.
+template <typename Key>
+class IntegerKeyTable {
+public:
+    using key_t = Key;
+    static constexpr uint64_t DEFAULT_MAX_DIRECT_RANGE = 1 << 20;
+    static constexpr uint64_t DEFAULT_MAX_DIRECT_SLOTS_PER_KEY = 16;
+
+    IntegerKeyTable(const Key* build_keys, size_t rows, uint64_t max_direct_range = DEFAULT_MAX_DIRECT_RANGE,
+                    uint64_t max_direct_slots_per_key = DEFAULT_MAX_DIRECT_SLOTS_PER_KEY) {
+        Key min_key = rows ? build_keys[0] : 0;
+        Key max_key = min_key;
+        for (size_t i = 1; i < rows; ++i) {
+            min_key = std::min(min_key, build_keys[i]);
+            max_key = std::max(max_key, build_keys[i]);
+        }
+        /// rows bound the distinct keys from above
+        if (direct_mapping_pays(uint64_t(max_key) - min_key, rows, max_direct_range, max_direct_slots_per_key)) {
+            direct = new DirectMappedTable<Key>(min_key, max_key);
+        } else {
+            hashed = new BasicHashTable<Key>(degree_for(rows));
+        }
+    }
+    /// the layout already chosen elsewhere: direct over [min_key, max_key]
+    IntegerKeyTable(Key min_key, Key max_key) {
+        direct = new DirectMappedTable<Key>(min_key, max_key);
+    }
+    IntegerKeyTable(const IntegerKeyTable&) = delete;
+    IntegerKeyTable& operator=(const IntegerKeyTable&) = delete;
+    ~IntegerKeyTable() {
+        delete direct;
+        delete hashed;
+    }
+
+    bool is_direct() const { return direct != nullptr; }
+
+    void insert(Key key, RowRef && value) {
+        if (direct && !direct->in_range(key)) convert_to_hashed();
+        if (direct) {
+            direct->insert(key, std::move(value));
+        } else {
+            hashed->insert(key, std::move(value));
+        }
+    }
+
+    void m_insert(Key* keys, RowRef* values, unsigned int block_size) {
+        if (direct && !std::all_of(keys, keys + block_size, [&](Key key) { return direct->in_range(key); })) {
+            convert_to_hashed();
+        }
+        if (direct) {
+            direct->m_insert(keys, values, block_size);
+        } else {
+            hashed->m_insert(keys, values, block_size);
+        }
+    }
+
+    index_t find(Key key) {
+        return direct ? direct->find(key) : hashed->find(key);
+    }
+
+    index_t* m_find(Key* keys, uint32_t block_size) {
+        return direct ? direct->m_find(keys, block_size) : hashed->m_find(keys, block_size);
+    }
+
+    RowRefList* get(index_t pos) {
+        return direct ? direct->get(pos) : hashed->get(pos);
+    }
+
+    index_t size() const { return direct ? direct->size() : hashed->size(); }
+
+    /// move every key into a BasicHashTable, their RowRefList batches move along
+    void convert_to_hashed() {
+        if (!direct) return;
+        hashed = new BasicHashTable<Key>(degree_for(direct->size() * 2));
+        direct->for_each([&](Key key, RowRefList &row_refs) {
+            hashed->insert_unique(typename BasicHashTable<Key>::Cell(key, row_refs));
+        });
+        direct->release_cells();
+        delete direct;
+        direct = nullptr;
+    }
+
+private:
+    static uint32_t degree_for(size_t rows) {
+        uint32_t degree = 10;
+        while (degree < 30 && (1ULL << degree) < rows) ++degree;
+        return degree;
+    }
+
+    DirectMappedTable<Key>* direct = nullptr;
+    BasicHashTable<Key>* hashed = nullptr;
+};
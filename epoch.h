@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+/// Epoch based reclamation for one writer and up to MAX_READERS readers.
+/// A reader publishes the global epoch in its slot while it reads and
+/// clears it after. Memory the writer unlinks is retired with the epoch it
+/// was unlinked in and freed once every active reader entered after it.
+/// Readers never wait, the writer never waits for readers either, it only
+/// frees later.
+class EpochManager {
+public:
+    static constexpr uint32_t MAX_READERS = 64;
+    static constexpr uint64_t INACTIVE = 0;
+
+    EpochManager() {
+        for (auto &slot : slots) {
+            slot.epoch.store(INACTIVE, std::memory_order_relaxed);
+            slot.used.store(false, std::memory_order_relaxed);
+        }
+    }
+    EpochManager(const EpochManager&) = delete;
+    EpochManager& operator=(const EpochManager&) = delete;
+    ~EpochManager() {
+        for (auto &retired_value : retired) {
+            retired_value.second();
+        }
+    }
+
+    /// claim a reader slot, MAX_READERS when all are taken
+    uint32_t register_reader() {
+        for (uint32_t i = 0; i < MAX_READERS; ++i) {
+            bool used = false;
+            if (slots[i].used.compare_exchange_strong(used, true)) return i;
+        }
+        return MAX_READERS;
+    }
+
+    void unregister_reader(uint32_t reader) {
+        slots[reader].epoch.store(INACTIVE);
+        slots[reader].used.store(false);
+    }
+
+    /// everything the reader loads between enter() and exit() stays valid
+    void enter(uint32_t reader) {
+        slots[reader].epoch.store(global_epoch.load());
+    }
+
+    void exit(uint32_t reader) {
+        slots[reader].epoch.store(INACTIVE, std::memory_order_release);
+    }
+
+    /// writer only: free is called once no reader can still hold what was
+    /// unlinked before this call
+    void retire(std::function<void()> free) {
+        retired.emplace_back(global_epoch.fetch_add(1), std::move(free));
+        reclaim();
+    }
+
+    /// writer only: free what every active reader has moved past
+    void reclaim() {
+        auto min_epoch = global_epoch.load();
+        for (auto &slot : slots) {
+            auto epoch = slot.epoch.load();
+            if (epoch != INACTIVE && epoch < min_epoch) {
+                min_epoch = epoch;
+            }
+        }
+        size_t kept = 0;
+        for (auto &retired_value : retired) {
+            if (retired_value.first < min_epoch) {
+                retired_value.second();
+            } else {
+                retired[kept++] = std::move(retired_value);
+            }
+        }
+        retired.resize(kept);
+    }
+
+    size_t retired_size() const { return retired.size(); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch;
+        std::atomic<bool> used;
+    };
+
+    /// starts at 1, INACTIVE is 0
+    std::atomic<uint64_t> global_epoch{1};
+    Slot slots[MAX_READERS];
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired;
+};
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include "String.h"
+
+/// Key stored inside the hash table cell.
+/// Keys up to N bytes are copied into the cell, longer keys keep the first
+/// N - 8 bytes inline as a prefix plus a pointer to the caller's memory.
+/// Size and prefix mismatches are decided without touching the key data.
+template <size_t N>
+struct InlineString {
+    static_assert(N >= 16 && N % 8 == 0, "inline size must be a multiple of 8 and at least 16");
+    static constexpr size_t INLINE_SIZE = N;
+    static constexpr size_t PREFIX_SIZE = N - sizeof(const char*);
+
+    InlineString() {}
+    InlineString(const String& key) : size_(key.size()) {
+        if (is_inline()) {
+            memcpy(inline_data, key.data(), size_);
+        } else {
+            memcpy(remote.prefix, key.data(), PREFIX_SIZE);
+            remote.ptr = key.data();
+        }
+    }
+
+    bool is_inline() const { return size_ <= INLINE_SIZE; }
+
+    /// points into the cell for inline keys, so it is only valid until the table resizes
+    const char* data() const { return is_inline() ? inline_data : remote.ptr; }
+
+    size_t size() const { return size_; }
+
+    String to_string() const { return String(data(), size_); }
+
+    bool operator==(const String& key) const {
+        if (size_ != key.size()) return false;
+        if (is_inline()) return memcmp(inline_data, key.data(), size_) == 0;
+        if (memcmp(remote.prefix, key.data(), PREFIX_SIZE) != 0) return false;
+        return memcmp(remote.ptr + PREFIX_SIZE, key.data() + PREFIX_SIZE, size_ - PREFIX_SIZE) == 0;
+    }
+
+    bool operator!=(const String& key) const { return !(*this == key); }
+
+private:
+    uint32_t size_ = 0;
+    union {
+        char inline_data[N];
+        struct {
+            char prefix[PREFIX_SIZE];
+            const char* ptr;
+        } remote;
+    };
+};
@@ -6,9 +6,13 @@
 #include "String.h"
 // #define CHECK
 // #define OLD
+// #define INLINE_KEY
+// #define ROBIN_HOOD
 #define USE_BLOCK
 #ifdef OLD
 #include "old_hash_table.h"
+#elif defined(ROBIN_HOOD)
+#include "robin_hood_hash_table.h"
 #else
 #include "new_hash_table.h"
 #endif
@@ -65,7 +69,13 @@ int main() {
     auto buildtimeS = std::chrono::steady_clock::now();
     printf("info: init begin\n");
     double duration_millsecond;
+#if defined(ROBIN_HOOD) && !defined(OLD)
+    RobinHoodHashTable hashtable(10);
+#elif defined(INLINE_KEY) && !defined(OLD)
+    InlineKeyHashTable hashtable(10);
+#else
     HashTable hashtable(10);
+#endif
     auto buildtimeE = std::chrono::steady_clock::now();
     duration_millsecond = std::chrono::duration<double, std::milli>(buildtimeE - buildtimeS).count();
     printf("build time: %lfms\n", duration_millsecond);
@@ -91,7 +101,7 @@ int main() {
         }
     }
 
-#ifdef OLD
+#if defined(OLD) || defined(ROBIN_HOOD)
     for (auto it : vis) {
         printf("info: find size %u\n", it.second.size());
         auto place_value = hashtable.find(it.first);
@@ -104,6 +114,29 @@ int main() {
             printf("error: no find that must exist!!!!!!!!\n");
         }
     }
+#if defined(ROBIN_HOOD) && !defined(OLD)
+    /// erase every other key: backward shift deletion must keep the rest
+    /// reachable, then erase the rest
+    auto erased = 0;
+    for (auto it : vis) {
+        if (erased++ % 2) continue;
+        if (!hashtable.erase(it.first) || hashtable.find(it.first) != RobinHoodHashTable::EMPTY) {
+            printf("error: erase key still found!!!!!!!!\n");
+        }
+    }
+    erased = 0;
+    for (auto it : vis) {
+        auto place_value = hashtable.find(it.first);
+        if (erased++ % 2 == 0) continue;
+        if (place_value == RobinHoodHashTable::EMPTY || !check(hashtable.get(place_value), it.second)) {
+            printf("error: key lost after erase!!!!!!!!\n");
+        }
+        hashtable.erase(it.first);
+    }
+    if (hashtable.size()) {
+        printf("error: table not empty after erase!!!!!!!!\n");
+    }
+#endif
 #else
     for (auto it : vis) {
         printf("info: find size %u\n", it.second.size());
@@ -117,6 +150,14 @@ int main() {
             printf("error: no find that must exist!!!!!!!!\n");
         }
     }
+    for (auto it : vis) {
+        if (!hashtable.erase(it.first) || hashtable.find(it.first)) {
+            printf("error: erase key still found!!!!!!!!\n");
+        }
+    }
+    if (hashtable.size()) {
+        printf("error: table not empty after erase!!!!!!!!\n");
+    }
 #endif
 #else
     auto inserttimeS = std::chrono::steady_clock::now();
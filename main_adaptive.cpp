@@ -0,0 +1,148 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include "adaptive_hash_table.h"
+
+/// build sides of different shapes: print what AdaptiveHashTable picks for
+/// each, and the build + probe time of every layout that applies, so the
+/// thresholds in TableChoiceSettings can be checked against the fastest one
+
+const size_t INSERT_NUM = 1000000;
+const size_t FIND_NUM = 4000000;
+const uint32_t BLOCK_NUM = 64;
+
+std::mt19937 rng(1337);
+
+String random_string(uint32_t size) {
+    const auto p = new char[size];
+    for (auto j = 0; j < size; j++) {
+        p[j] = 'a' + rng() % 26;
+    }
+    return String(p, size);
+}
+
+uint64_t random_uint64() {
+    return (uint64_t(rng()) << 32) | rng();
+}
+
+/// rows drawn from distinct keys made by gen, the probes hit half the time
+template <typename Key, typename Gen>
+void make_side(size_t distinct, Gen gen, std::vector<Key> &keys, std::vector<Key> &probes) {
+    std::vector<Key> values;
+    for (size_t i = 0; i < distinct; i++) {
+        values.push_back(gen());
+    }
+    keys.clear();
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        keys.push_back(i < distinct ? values[i] : values[rng() % distinct]);
+    }
+    std::shuffle(keys.begin(), keys.end(), rng);
+    probes.clear();
+    for (size_t i = 0; i < FIND_NUM; i++) {
+        probes.push_back(rng() % 2 ? values[rng() % distinct] : gen());
+    }
+}
+
+template <typename Key>
+double run(const TableChoice &choice, std::vector<Key> &keys, std::vector<Key> &probes, uint64_t &found) {
+    auto timeS = std::chrono::steady_clock::now();
+    AdaptiveHashTable<Key> hashtable(choice);
+    std::vector<RowRef> values;
+    for (size_t i = 0; i < BLOCK_NUM; i++) {
+        values.emplace_back(i, 0);
+    }
+    for (size_t i = 0; i < keys.size(); i += BLOCK_NUM) {
+        hashtable.m_insert(keys.data() + i, values.data(), std::min<size_t>(BLOCK_NUM, keys.size() - i));
+    }
+    for (size_t i = 0; i < probes.size(); i += BLOCK_NUM) {
+        auto res = hashtable.m_find(probes.data() + i, BLOCK_NUM);
+        for (auto j = 0; j < BLOCK_NUM; j++) {
+            found += res[j] != 0;
+        }
+        delete[] res;
+    }
+    auto timeE = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(timeE - timeS).count();
+}
+
+template <typename Key>
+void compare(const char* name, std::vector<Key> &keys, std::vector<Key> &probes, std::vector<TableLayout> layouts) {
+    auto sampletimeS = std::chrono::steady_clock::now();
+    auto choice = choose_table<Key>(sample_build(keys.data(), keys.size()));
+    auto sampletimeE = std::chrono::steady_clock::now();
+    printf("== %s\nchoice: %s\nsample time: %lfms\n", name, choice.describe().c_str(),
+           std::chrono::duration<double, std::milli>(sampletimeE - sampletimeS).count());
+    for (auto layout : layouts) {
+        auto forced = choice;
+        forced.layout = layout;
+        uint64_t found = 0;
+        auto duration_millsecond = run(forced, keys, probes, found);
+        printf("%s%s time: %lfms, found %lu\n", layout == choice.layout ? "* " : "  ", layout_name(layout),
+               duration_millsecond, found);
+    }
+}
+
+/// a DIRECT_MAPPED table must take keys outside the range it was built for
+void check_out_of_range() {
+    std::vector<uint64_t> keys;
+    for (uint64_t key = 1000; key < 2000; key++) {
+        keys.push_back(key);
+    }
+    AdaptiveHashTable<uint64_t> hashtable(keys.data(), keys.size());
+    if (hashtable.choice().layout != TableLayout::DIRECT_MAPPED) {
+        printf("error: dense keys chose %s\n", layout_name(hashtable.choice().layout));
+    }
+    std::vector<RowRef> values;
+    for (size_t i = 0; i < keys.size(); i++) {
+        values.emplace_back(i, 0);
+    }
+    hashtable.m_insert(keys.data(), values.data(), keys.size());
+    hashtable.insert(5, RowRef(0, 1));
+    hashtable.insert(1u << 30, RowRef(0, 1));
+    keys.push_back(5);
+    keys.push_back(1u << 30);
+    uint64_t errors = 0;
+    for (auto key : keys) {
+        auto pos = hashtable.find(key);
+        if (!pos || hashtable.get(pos - 1)->get_row_count() != 1) {
+            ++errors;
+        }
+    }
+    if (hashtable.size() != keys.size() || hashtable.find(3000)) {
+        ++errors;
+    }
+    printf("== keys outside the direct mapped range\nerrors: %lu\n", errors);
+}
+
+int main() {
+    check_out_of_range();
+    std::vector<TableLayout> string_layouts = {TableLayout::SMALL, TableLayout::CHAINED, TableLayout::INLINE_KEY,
+                                               TableLayout::BY_LENGTH, TableLayout::ROBIN_HOOD};
+    std::vector<TableLayout> integer_layouts = {TableLayout::SMALL, TableLayout::CHAINED,
+                                                TableLayout::DIRECT_MAPPED};
+    std::vector<String> keys, probes;
+
+    make_side<String>(INSERT_NUM, [] { return random_string(64); }, keys, probes);
+    compare("unique 64 byte strings", keys, probes, {TableLayout::CHAINED, TableLayout::INLINE_KEY,
+                                                     TableLayout::BY_LENGTH, TableLayout::ROBIN_HOOD});
+    make_side<String>(INSERT_NUM / 10, [] { return random_string(64); }, keys, probes);
+    compare("64 byte strings, 10 rows per key", keys, probes, {TableLayout::CHAINED, TableLayout::INLINE_KEY,
+                                                               TableLayout::BY_LENGTH, TableLayout::ROBIN_HOOD});
+    make_side<String>(INSERT_NUM, [] { return random_string(12); }, keys, probes);
+    compare("unique 12 byte strings", keys, probes, {TableLayout::CHAINED, TableLayout::INLINE_KEY,
+                                                     TableLayout::BY_LENGTH, TableLayout::ROBIN_HOOD});
+    make_side<String>(INSERT_NUM, [] { return random_string(rng() % 5 ? 12 : 64); }, keys, probes);
+    compare("unique 12 and 64 byte strings", keys, probes, {TableLayout::CHAINED, TableLayout::INLINE_KEY,
+                                                            TableLayout::BY_LENGTH, TableLayout::ROBIN_HOOD});
+    make_side<String>(20, [] { return random_string(64); }, keys, probes);
+    compare("20 distinct strings", keys, probes, string_layouts);
+
+    std::vector<uint64_t> int_keys, int_probes;
+    uint64_t next_key = 0;
+    make_side<uint64_t>(INSERT_NUM, [&] { return next_key++; }, int_keys, int_probes);
+    compare("dense uint64", int_keys, int_probes, {TableLayout::CHAINED, TableLayout::DIRECT_MAPPED});
+    make_side<uint64_t>(INSERT_NUM, random_uint64, int_keys, int_probes);
+    compare("random uint64", int_keys, int_probes, {TableLayout::CHAINED});
+    make_side<uint64_t>(20, random_uint64, int_keys, int_probes);
+    compare("20 distinct uint64", int_keys, int_probes, {TableLayout::SMALL, TableLayout::CHAINED});
+}
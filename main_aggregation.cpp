@@ -0,0 +1,66 @@
+#include <random>
+#include <unordered_map>
+#include <chrono>
+#include <vector>
+#include "aggregation_hash_table.h"
+
+/// SELECT key, count(), sum(value) GROUP BY key over UInt64 keys,
+/// AggregationHashTable against std::unordered_map
+
+const size_t ROW_NUM = 10000000;
+const uint32_t BLOCK_NUM = 4096;
+
+std::mt19937_64 rng(1337);
+
+struct CountSum {
+    uint64_t count = 0;
+    int64_t sum = 0;
+};
+
+void bench(size_t group_num) {
+    std::vector<uint64_t> keys(ROW_NUM);
+    std::vector<int64_t> values(ROW_NUM);
+    for (size_t i = 0; i < ROW_NUM; i++) {
+        keys[i] = rng() % group_num * 0x9e3779b97f4a7c15ULL;
+        values[i] = rng() % 1000;
+    }
+    double duration_millsecond;
+
+    auto hashtimeS = std::chrono::steady_clock::now();
+    AggregationHashTable<uint64_t, CountSum> table(10);
+    CountSum* states[BLOCK_NUM];
+    for (size_t i = 0; i < ROW_NUM; i += BLOCK_NUM) {
+        uint32_t block_size = std::min<size_t>(BLOCK_NUM, ROW_NUM - i);
+        table.m_emplace_column(keys.data(), i, block_size, states);
+        for (uint32_t j = 0; j < block_size; j++) {
+            ++states[j]->count;
+            states[j]->sum += values[i + j];
+        }
+    }
+    int64_t total = 0;
+    table.finalize([&](uint64_t, const CountSum &state) { total += state.sum + state.count; });
+    auto hashtimeE = std::chrono::steady_clock::now();
+    duration_millsecond = std::chrono::duration<double, std::milli>(hashtimeE - hashtimeS).count();
+    printf("groups %zu, hash table: %lfms, check %ld\n", size_t(table.size()), duration_millsecond, total);
+
+    auto maptimeS = std::chrono::steady_clock::now();
+    std::unordered_map<uint64_t, CountSum> map;
+    for (size_t i = 0; i < ROW_NUM; i++) {
+        auto &state = map[keys[i]];
+        ++state.count;
+        state.sum += values[i];
+    }
+    total = 0;
+    for (auto &it : map) {
+        total += it.second.sum + it.second.count;
+    }
+    auto maptimeE = std::chrono::steady_clock::now();
+    duration_millsecond = std::chrono::duration<double, std::milli>(maptimeE - maptimeS).count();
+    printf("groups %zu, unordered_map: %lfms, check %ld\n", map.size(), duration_millsecond, total);
+}
+
+int main() {
+    bench(1000);
+    bench(100000);
+    bench(5000000);
+}
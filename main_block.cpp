@@ -7,6 +7,7 @@
 #include "xxhash64.h"
 #include "String.h"
 #define CHECK
+// #define USE_COLUMN
 #include "new_hash_table.h"
 
 const size_t INSERT_NUM = 10000000;
@@ -50,9 +51,21 @@ int main() {
 
 #ifdef CHECK
     std::vector<std::pair<String, RowRef>> datas;
+#ifdef USE_COLUMN
+    /// the same keys as one contiguous column, row i is RowRef(i, 0)
+    std::vector<char> chars(TEST_NUM * 64);
+    std::vector<uint32_t> offsets(TEST_NUM + 1);
+    StringColumn column{chars.data(), offsets.data()};
+#endif
     for (int i = 0; i < TEST_NUM; i++) {
+#ifdef USE_COLUMN
+        const auto p = chars.data() + i * 64;
+        RowRef rf(i, 0);
+        offsets[i + 1] = (i + 1) * 64;
+#else
         const auto p = new char[64];
         RowRef rf(rng() % INSERT_NUM, rng() % INSERT_NUM);
+#endif
         for (auto j = 0; j < 64; j++) {
             p[j] = rng() % (1 << 8);
         }
@@ -76,7 +89,11 @@ int main() {
             values[j - i] = datas[j].second;
         }
         //printf("block size %d\n", block_size);
+#ifdef USE_COLUMN
+        hashtable.m_insert_column(column, i, block_size, 0);
+#else
         hashtable.m_insert(keys, values, block_size);
+#endif
         delete[] keys;
         delete[] values;
         i += BLOCK_NUM;
@@ -90,7 +107,12 @@ int main() {
             ++block_size;
             keys[j - i] = datas[j].first;
         }
+#ifdef USE_COLUMN
+        auto res = new index_t[BLOCK_NUM];
+        hashtable.m_find_column(column, i, block_size, res);
+#else
         auto res = hashtable.m_find(keys, block_size);
+#endif
         for (auto j = 0; j < block_size; j++) {
             //printf("info: find size %lu\n", vis[keys[j]].size());
             if (res[j] == 0) {
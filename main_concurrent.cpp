@@ -0,0 +1,128 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <unordered_map>
+#include "concurrent_hash_table.h"
+
+/// one writer inserting into ConcurrentHashTable while READER_NUM threads
+/// probe it. Every probe is checked against a reference: a key the writer
+/// had inserted before the probe started must be found with its first row,
+/// a key that is never inserted must not be found. Once the writer is done
+/// every retired version must be freed and every list must be complete.
+
+const size_t INSERT_NUM = 4000000;
+const uint32_t BLOCK_NUM = 64;
+const uint32_t READER_NUM = 4;
+
+uint64_t random_uint64(std::mt19937 &rng) {
+    return (uint64_t(rng()) << 32) | rng();
+}
+
+struct Expected {
+    /// index of the first row of the key, its RowRef is RowRef(first, 0)
+    size_t first;
+    uint32_t count;
+};
+
+int main() {
+    std::mt19937 rng(1337);
+    std::vector<uint64_t> values(INSERT_NUM / 4);
+    for (auto &value : values) {
+        value = random_uint64(rng);
+    }
+    std::vector<uint64_t> keys(INSERT_NUM);
+    std::unordered_map<uint64_t, Expected> reference;
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        keys[i] = values[rng() % values.size()];
+        auto it = reference.emplace(keys[i], Expected{i, 0}).first;
+        ++it->second.count;
+    }
+
+    ConcurrentHashTable<uint64_t> hashtable(10);
+    /// rows the writer has inserted, stored after each block
+    std::atomic<size_t> inserted{0};
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> errors{0};
+    std::vector<uint64_t> probes(READER_NUM, 0);
+
+    auto timeS = std::chrono::steady_clock::now();
+    std::vector<std::thread> readers;
+    for (uint32_t t = 0; t < READER_NUM; t++) {
+        readers.emplace_back([&, t] {
+            std::mt19937 reader_rng(t);
+            ConcurrentHashTable<uint64_t>::Reader reader(hashtable);
+            if (!reader.valid()) {
+                printf("error: no reader slot\n");
+                ++errors;
+                return;
+            }
+            std::vector<uint64_t> block(BLOCK_NUM);
+            while (!done.load()) {
+                auto before = inserted.load(std::memory_order_acquire);
+                for (auto &key : block) {
+                    key = reader_rng() % 2 ? values[reader_rng() % values.size()] : random_uint64(reader_rng);
+                }
+                auto res = reader.m_find(block.data(), BLOCK_NUM);
+                for (auto j = 0; j < BLOCK_NUM; j++) {
+                    auto it = reference.find(block[j]);
+                    if (it == reference.end() || it->second.first >= before) {
+                        if (it == reference.end() && res[j]) {
+                            printf("error: key %lu never inserted but found\n", block[j]);
+                            ++errors;
+                        }
+                        continue;
+                    }
+                    if (!res[j]) {
+                        printf("error: key %lu inserted at row %zu not found\n", block[j], it->second.first);
+                        ++errors;
+                    } else if (reader.first_row(res[j] - 1).row_num != it->second.first) {
+                        printf("error: key %lu has the wrong first row\n", block[j]);
+                        ++errors;
+                    }
+                }
+                delete[] res;
+                probes[t] += BLOCK_NUM;
+            }
+        });
+    }
+
+    std::vector<RowRef> rows(BLOCK_NUM);
+    for (size_t i = 0; i < INSERT_NUM; i += BLOCK_NUM) {
+        for (auto j = 0; j < BLOCK_NUM; j++) {
+            rows[j] = RowRef(i + j, 0);
+        }
+        hashtable.m_insert(keys.data() + i, rows.data(), BLOCK_NUM);
+        inserted.store(i + BLOCK_NUM, std::memory_order_release);
+    }
+    auto inserttimeE = std::chrono::steady_clock::now();
+    done.store(true);
+    for (auto &reader : readers) {
+        reader.join();
+    }
+    uint64_t probe_num = 0;
+    for (auto probe : probes) {
+        probe_num += probe;
+    }
+    printf("insert time with %u readers: %lfms, probes %lu\n", READER_NUM,
+           std::chrono::duration<double, std::milli>(inserttimeE - timeS).count(), probe_num);
+
+    hashtable.reclaim();
+    if (hashtable.retired_size()) {
+        printf("error: %zu retired versions left after reclaim\n", hashtable.retired_size());
+        ++errors;
+    }
+    if (hashtable.size() != reference.size()) {
+        printf("error: size %u != %zu\n", hashtable.size(), reference.size());
+        ++errors;
+    }
+    for (auto &it : reference) {
+        auto pos = hashtable.find(it.first);
+        if (!pos || hashtable.get(pos - 1)->get_row_count() != it.second.count) {
+            printf("error: key %lu has a wrong row count\n", it.first);
+            if (++errors > 10) break;
+        }
+    }
+    printf("errors: %lu\n", errors.load());
+}
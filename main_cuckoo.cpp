@@ -0,0 +1,92 @@
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <vector>
+#include "xxhash32.h"
+#include "String.h"
+#include "new_hash_table.h"
+#include "robin_hood_hash_table.h"
+#include "cuckoo_hash_table.h"
+
+/// per probe latency percentiles of the chained, Robin Hood and cuckoo
+/// tables, on random keys and on keys whose hashes share their low bits
+
+const size_t INSERT_NUM = 1000000;
+const size_t FIND_NUM = 1000000;
+const size_t ADVERSARIAL_NUM = 2000;
+const uint32_t ADVERSARIAL_MASK = (1 << 14) - 1;
+
+std::mt19937 rng(1337);
+
+const char* random_key() {
+    const auto p = new char[64];
+    for (auto j = 0; j < 64; j++) {
+        p[j] = rng() % (1 << 8);
+    }
+    return p;
+}
+
+/// a key whose hash has the low bits zero, every one lands in the same
+/// few buckets of the chained and linear probing tables
+const char* adversarial_key() {
+    const auto p = new char[64];
+    do {
+        for (auto j = 0; j < 64; j++) {
+            p[j] = rng() % (1 << 8);
+        }
+    } while (XXHash32::hash(p, 64, 0) & ADVERSARIAL_MASK);
+    return p;
+}
+
+template <typename Table>
+void bench(const char* name, const std::vector<String> &keys, const std::vector<String> &probes) {
+    Table hashtable(10);
+    for (size_t i = 0; i < keys.size(); i++) {
+        hashtable.insert(keys[i], RowRef(i, 1));
+    }
+
+    std::vector<double> latencies(probes.size());
+    uint64_t sink = 0;
+    for (size_t i = 0; i < probes.size(); i++) {
+        auto findtimeS = std::chrono::steady_clock::now();
+        sink += hashtable.find(probes[i]);
+        auto findtimeE = std::chrono::steady_clock::now();
+        latencies[i] = std::chrono::duration<double, std::nano>(findtimeE - findtimeS).count();
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto percentile = [&](double p) { return latencies[std::min(latencies.size() - 1, size_t(p * latencies.size()))]; };
+    printf("%-12s p50 %6.0fns  p99 %6.0fns  p99.9 %6.0fns  max %8.0fns  collision num %u  (%lu)\n", name,
+           percentile(0.5), percentile(0.99), percentile(0.999), latencies.back(), hashtable.next_num(), sink % 2);
+}
+
+void bench_all(const std::vector<String> &keys, const std::vector<String> &probes) {
+    bench<HashTable>("chained", keys, probes);
+    bench<RobinHoodHashTable>("robin hood", keys, probes);
+    bench<CuckooHashTable<String>>("cuckoo", keys, probes);
+}
+
+int main() {
+    std::vector<String> keys;
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        keys.emplace_back(random_key());
+    }
+    std::vector<String> probes;
+    for (size_t i = 0; i < FIND_NUM; i++) {
+        probes.emplace_back(rng() % 2 ? keys[rng() % INSERT_NUM] : String(random_key()));
+    }
+    printf("info: random keys\n");
+    bench_all(keys, probes);
+
+    std::vector<String> adversarial;
+    for (size_t i = 0; i < ADVERSARIAL_NUM; i++) {
+        adversarial.emplace_back(adversarial_key());
+    }
+    keys.insert(keys.end(), adversarial.begin(), adversarial.end());
+    for (size_t i = 0; i < FIND_NUM / 100; i++) {
+        probes[i] = adversarial[rng() % ADVERSARIAL_NUM];
+    }
+    std::shuffle(probes.begin(), probes.end(), rng);
+    printf("info: with %lu keys colliding in the low %d hash bits, 1%% of probes on them\n", ADVERSARIAL_NUM,
+           __builtin_popcount(ADVERSARIAL_MASK));
+    bench_all(keys, probes);
+}
@@ -0,0 +1,138 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include <unordered_map>
+#include "direct_mapped_table.h"
+
+/// IntegerKeyTable on build sides of different densities: which layout it
+/// picks, that every find matches a reference, and the build + probe time
+/// against the chained UInt64HashTable
+
+const size_t INSERT_NUM = 1000000;
+const size_t FIND_NUM = 4000000;
+const uint32_t BLOCK_NUM = 64;
+
+std::mt19937 rng(1337);
+
+uint64_t errors = 0;
+
+template <typename Table, typename Key>
+void check(Table &hashtable, const std::unordered_map<Key, uint32_t> &reference, const std::vector<Key> &probes) {
+    if (hashtable.size() != reference.size()) {
+        printf("error: size %zu != %zu\n", size_t(hashtable.size()), reference.size());
+        ++errors;
+    }
+    for (auto key : probes) {
+        auto it = reference.find(key);
+        auto pos = hashtable.find(key);
+        if (it == reference.end() ? pos != 0 : pos == 0 || hashtable.get(pos - 1)->get_row_count() != it->second) {
+            printf("error: key %lu found at %zu\n", uint64_t(key), size_t(pos));
+            if (++errors > 10) exit(0);
+        }
+    }
+}
+
+template <typename Table, typename Key>
+double run(Table &hashtable, std::vector<Key> &keys, std::vector<Key> &probes, uint64_t &found) {
+    auto timeS = std::chrono::steady_clock::now();
+    std::vector<RowRef> values;
+    for (size_t i = 0; i < BLOCK_NUM; i++) {
+        values.emplace_back(i, 0);
+    }
+    for (size_t i = 0; i < keys.size(); i += BLOCK_NUM) {
+        hashtable.m_insert(keys.data() + i, values.data(), std::min<size_t>(BLOCK_NUM, keys.size() - i));
+    }
+    for (size_t i = 0; i < probes.size(); i += BLOCK_NUM) {
+        auto res = hashtable.m_find(probes.data() + i, BLOCK_NUM);
+        for (auto j = 0; j < BLOCK_NUM; j++) {
+            found += res[j] != 0;
+        }
+        delete[] res;
+    }
+    auto timeE = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(timeE - timeS).count();
+}
+
+/// build keys are min_key + rng() % range, probes come from twice the range
+void compare(const char* name, uint64_t min_key, uint64_t range) {
+    std::vector<uint64_t> keys(INSERT_NUM), probes(FIND_NUM);
+    std::unordered_map<uint64_t, uint32_t> reference;
+    for (auto &key : keys) {
+        key = min_key + rng() % range;
+        ++reference[key];
+    }
+    for (auto &probe : probes) {
+        probe = min_key + rng() % (range * 2);
+    }
+
+    IntegerKeyTable<uint64_t> table(keys.data(), keys.size());
+    uint64_t found = 0;
+    auto duration_millsecond = run(table, keys, probes, found);
+    printf("== %s\n%s time: %lfms, found %lu\n", name, table.is_direct() ? "direct" : "hashed", duration_millsecond, found);
+    check(table, reference, probes);
+
+    UInt64HashTable hashtable(10);
+    found = 0;
+    duration_millsecond = run(hashtable, keys, probes, found);
+    printf("chained time: %lfms, found %lu\n", duration_millsecond, found);
+}
+
+int main() {
+    compare("dense keys", 1000, INSERT_NUM / 4);
+    compare("sparse keys", 1 << 20, 1ULL << 40);
+
+    /// two keys far apart: the range is small enough but holds 16 slots per key
+    std::vector<uint64_t> pair = {0, IntegerKeyTable<uint64_t>::DEFAULT_MAX_DIRECT_RANGE / 2};
+    IntegerKeyTable<uint64_t> pair_table(pair.data(), pair.size());
+    if (pair_table.is_direct()) {
+        printf("error: two keys %lu apart went direct\n", pair[1]);
+        ++errors;
+    }
+
+    /// keys outside the build range convert to the hashed layout
+    std::vector<uint32_t> build(1000), later(1000);
+    std::unordered_map<uint32_t, uint32_t> reference;
+    for (size_t i = 0; i < build.size(); i++) {
+        build[i] = 5000 + i;
+        later[i] = 5500 + i * 3;
+    }
+    IntegerKeyTable<uint32_t> grown(build.data(), build.size());
+    if (!grown.is_direct()) {
+        printf("error: dense build did not go direct\n");
+        ++errors;
+    }
+    for (auto key : build) {
+        grown.insert(key, RowRef(key, 0));
+        ++reference[key];
+    }
+    for (auto key : later) {
+        grown.insert(key, RowRef(key, 1));
+        ++reference[key];
+    }
+    if (grown.is_direct()) {
+        printf("error: out of range insert did not convert\n");
+        ++errors;
+    }
+    std::vector<uint32_t> grown_probes;
+    for (uint32_t key = 4000; key < 10000; key++) {
+        grown_probes.push_back(key);
+    }
+    check(grown, reference, grown_probes);
+
+    /// the whole uint8 domain, and a loud failure outside a narrower one
+    DirectMappedTable<uint8_t> whole;
+    whole.insert(255, RowRef(0, 0));
+    whole.insert(0, RowRef(1, 0));
+    if (whole.size() != 2 || whole.find(255) != 256 || whole.find(0) != 1 || whole.find(7)) {
+        printf("error: uint8 domain\n");
+        ++errors;
+    }
+    DirectMappedTable<uint16_t> narrow(10, 20);
+    try {
+        narrow.insert(21, RowRef(0, 0));
+        printf("error: key outside [10, 20] inserted\n");
+        ++errors;
+    } catch (const std::out_of_range &) {
+    }
+    printf("errors: %lu\n", errors);
+}
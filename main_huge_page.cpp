@@ -0,0 +1,91 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "new_hash_table.h"
+
+/// probe a table far bigger than the TLB reach of 4K pages, with buf/first/next
+/// on the heap and on transparent huge pages, and count dTLB load misses
+
+const size_t INSERT_NUM = 2000000;
+const size_t FIND_NUM = 10000000;
+
+std::mt19937_64 rng(1337);
+
+/// dTLB load miss counter, -1 when perf events are not available
+struct DTLBCounter {
+    int fd = -1;
+    DTLBCounter() {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HW_CACHE;
+        attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+    ~DTLBCounter() {
+        if (fd != -1) close(fd);
+    }
+    void start() {
+        if (fd == -1) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    long long stop() {
+        if (fd == -1) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long res = -1;
+        if (read(fd, &res, sizeof(res)) != sizeof(res)) return -1;
+        return res;
+    }
+};
+
+template <typename Table>
+void bench(const char* name, const std::vector<uint64_t> &keys, const std::vector<uint64_t> &probes) {
+    double duration_millsecond;
+    Table hashtable(10);
+
+    auto inserttimeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < keys.size(); i++) {
+        hashtable.insert(keys[i], RowRef(i, 0));
+    }
+    auto inserttimeE = std::chrono::steady_clock::now();
+    duration_millsecond = std::chrono::duration<double, std::milli>(inserttimeE - inserttimeS).count();
+    printf("%s insert time: %lfms\n", name, duration_millsecond);
+
+    DTLBCounter counter;
+    uint32_t found = 0;
+    counter.start();
+    auto findtimeS = std::chrono::steady_clock::now();
+    for (auto key : probes) {
+        found += hashtable.find(key) != 0;
+    }
+    auto findtimeE = std::chrono::steady_clock::now();
+    auto misses = counter.stop();
+    duration_millsecond = std::chrono::duration<double, std::milli>(findtimeE - findtimeS).count();
+    printf("%s find time: %lfms, found %u\n", name, duration_millsecond, found);
+    printf("%s dTLB load misses: %lld\n", name, misses);
+}
+
+int main() {
+    std::vector<uint64_t> keys(INSERT_NUM);
+    for (auto &key : keys) {
+        key = rng();
+    }
+    std::vector<uint64_t> probes(FIND_NUM);
+    for (auto &probe : probes) {
+        probe = rng() % 2 ? keys[rng() % INSERT_NUM] : rng();
+    }
+
+    bench<BasicHashTable<uint64_t>>("heap", keys, probes);
+    bench<BasicHashTable<uint64_t, uint64_t, MmapAllocator<HugePages::NONE>>>("mmap", keys, probes);
+    bench<BasicHashTable<uint64_t, uint64_t, MmapAllocator<HugePages::TRANSPARENT>>>("thp", keys, probes);
+    bench<BasicHashTable<uint64_t, uint64_t, MmapAllocator<HugePages::EXPLICIT>>>("hugetlb", keys, probes);
+}
@@ -0,0 +1,102 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include "new_hash_table.h"
+#include "ordered_index.h"
+
+/// OrderedIndex against HashTable on 1M keys sharing long prefixes
+/// ("customer/0000123456/order/..."): build, point lookups, and prefix
+/// and range scans, which the hash table can only answer with a full scan
+
+const size_t INSERT_NUM = 1000000;
+const size_t FIND_NUM = 10000000;
+const size_t SCAN_NUM = 1000;
+const size_t KEY_SIZE = 40;
+const size_t PREFIX_SIZE = 19;
+
+std::mt19937 rng(1337);
+
+String make_key(uint32_t customer, uint32_t order) {
+    auto p = new char[KEY_SIZE + 1];
+    snprintf(p, KEY_SIZE + 1, "customer/%010u/order/%014u", customer, order);
+    return String(p, KEY_SIZE);
+}
+
+double millisecond_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    std::vector<String> keys;
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        keys.push_back(make_key(rng() % 100000, rng()));
+    }
+    std::vector<String> probes;
+    for (size_t i = 0; i < FIND_NUM; i++) {
+        probes.push_back(rng() % 2 ? keys[rng() % INSERT_NUM] : keys[rng() % INSERT_NUM / 2]);
+    }
+    for (size_t i = 0; i < FIND_NUM; i += 2) {
+        probes[i] = make_key(rng() % 100000, rng());
+    }
+
+    HashTable hashtable(10);
+    OrderedIndex index;
+    auto timeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        hashtable.insert(keys[i], RowRef(i, 0));
+    }
+    printf("hash table insert time: %lfms\n", millisecond_since(timeS));
+    timeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        index.insert(keys[i], RowRef(i, 0));
+    }
+    printf("ordered index insert time: %lfms\n", millisecond_since(timeS));
+
+    uint64_t found = 0;
+    timeS = std::chrono::steady_clock::now();
+    for (auto &probe : probes) {
+        found += hashtable.find(probe) != 0;
+    }
+    printf("hash table find time: %lfms, found %lu\n", millisecond_since(timeS), found);
+    found = 0;
+    timeS = std::chrono::steady_clock::now();
+    for (auto &probe : probes) {
+        found += index.find(probe) != nullptr;
+    }
+    printf("ordered index find time: %lfms, found %lu\n", millisecond_since(timeS), found);
+
+    /// LIKE 'customer/<id>/%' for SCAN_NUM customers
+    std::vector<String> prefixes;
+    for (size_t i = 0; i < SCAN_NUM; i++) {
+        auto p = new char[PREFIX_SIZE + 1];
+        snprintf(p, PREFIX_SIZE + 1, "customer/%010u", uint32_t(rng() % 100000));
+        prefixes.emplace_back(p, PREFIX_SIZE);
+    }
+    uint64_t rows = 0;
+    timeS = std::chrono::steady_clock::now();
+    for (auto &prefix : prefixes) {
+        index.prefix(prefix, [&](const String &, RowRefList &row_refs) { rows += row_refs.get_row_count(); });
+    }
+    printf("ordered index %lu prefix scans: %lfms, rows %lu\n", SCAN_NUM, millisecond_since(timeS), rows);
+    rows = 0;
+    timeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < SCAN_NUM / 100; i++) {
+        for (auto &cell : hashtable) {
+            if (cell.first.starts_with(prefixes[i])) rows += cell.second.get_row_count();
+        }
+    }
+    printf("hash table %lu full scans: %lfms, rows %lu\n", SCAN_NUM / 100, millisecond_since(timeS), rows);
+
+    /// customers in [c, c + 100)
+    rows = 0;
+    timeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < SCAN_NUM; i++) {
+        auto customer = uint32_t(rng() % 100000);
+        char begin[PREFIX_SIZE + 1], end[PREFIX_SIZE + 1];
+        snprintf(begin, PREFIX_SIZE + 1, "customer/%010u", customer);
+        snprintf(end, PREFIX_SIZE + 1, "customer/%010u", customer + 100);
+        index.range(String(begin, PREFIX_SIZE), String(end, PREFIX_SIZE),
+                    [&](const String &, RowRefList &row_refs) { rows += row_refs.get_row_count(); });
+    }
+    printf("ordered index %lu range scans: %lfms, rows %lu\n", SCAN_NUM, millisecond_since(timeS), rows);
+}
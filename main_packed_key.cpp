@@ -0,0 +1,130 @@
+#include <random>
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "new_hash_table.h"
+
+/// joins on three fixed width columns, one of them nullable: KeyPacker
+/// keys in UInt128HashTable against the same columns serialized into
+/// String keys, both checked row by row against a reference built from
+/// the column values; a wider column set that does not fit 16 bytes
+/// takes the serialized path only
+
+const size_t INSERT_NUM = 1000000;
+const size_t FIND_NUM = 1000000;
+const uint32_t BLOCK_NUM = 64;
+
+std::mt19937 rng(1337);
+
+/// columns a (W1 bytes), b (W2 bytes, nullable) and c (W3 bytes)
+template <typename A, typename B, typename C>
+struct Rows {
+    std::vector<A> a;
+    std::vector<B> b;
+    std::vector<uint8_t> b_null;
+    std::vector<C> c;
+
+    Rows(size_t num, uint32_t domain) {
+        for (size_t i = 0; i < num; i++) {
+            a.push_back(rng() % domain);
+            b.push_back(rng() % 50);
+            b_null.push_back(rng() % 10 == 0);
+            c.push_back(rng() % 20);
+        }
+    }
+
+    std::vector<FixedColumn> columns() const {
+        return {{reinterpret_cast<const char*>(a.data()), sizeof(A)},
+                {reinterpret_cast<const char*>(b.data()), sizeof(B), b_null.data()},
+                {reinterpret_cast<const char*>(c.data()), sizeof(C)}};
+    }
+
+    /// the reference key, from the values and not from KeyPacker
+    std::string reference(size_t i) const {
+        return std::to_string(a[i]) + "|" + (b_null[i] ? "N" : std::to_string(b[i])) + "|" + std::to_string(c[i]);
+    }
+};
+
+template <typename Table, typename Key, typename Rows, typename Pack>
+double run(Table &hashtable, const Rows &build, const Rows &probe, Pack &&pack, uint64_t &errors) {
+    std::unordered_map<std::string, uint32_t> reference;
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        ++reference[build.reference(i)];
+    }
+    KeyPacker<UInt128> build_packer(build.columns());
+    KeyPacker<UInt128> probe_packer(probe.columns());
+    std::vector<Key> keys(BLOCK_NUM);
+    std::vector<RowRef> values(BLOCK_NUM);
+
+    auto timeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < INSERT_NUM; i += BLOCK_NUM) {
+        pack(build_packer, i, keys.data());
+        for (uint32_t j = 0; j < BLOCK_NUM; j++) {
+            values[j] = RowRef(i + j, 0);
+        }
+        hashtable.m_insert(keys.data(), values.data(), BLOCK_NUM);
+    }
+    std::vector<index_t> found(FIND_NUM);
+    for (size_t i = 0; i < FIND_NUM; i += BLOCK_NUM) {
+        pack(probe_packer, i, keys.data());
+        auto res = hashtable.m_find(keys.data(), BLOCK_NUM);
+        std::copy(res, res + BLOCK_NUM, found.begin() + i);
+        delete[] res;
+    }
+    auto timeE = std::chrono::steady_clock::now();
+
+    if (hashtable.size() != reference.size()) ++errors;
+    for (size_t i = 0; i < FIND_NUM; i++) {
+        auto it = reference.find(probe.reference(i));
+        auto count = found[i] ? hashtable.get(found[i] - 1)->get_row_count() : 0;
+        if (count != (it == reference.end() ? 0 : it->second)) ++errors;
+    }
+    return std::chrono::duration<double, std::milli>(timeE - timeS).count();
+}
+
+int main() {
+    uint64_t errors = 0;
+    double duration_millsecond;
+    {
+        /// 4 + 2 + 8 bytes and a null byte fit 16 bytes
+        Rows<uint32_t, uint16_t, uint64_t> build(INSERT_NUM, 1000), probe(FIND_NUM, 1200);
+        if (!KeyPacker<UInt128>(build.columns()).is_packed()) printf("error: 15 byte key not packed\n");
+
+        UInt128HashTable packed(10);
+        duration_millsecond = run<UInt128HashTable, UInt128>(packed, build, probe,
+                [](const KeyPacker<UInt128> &packer, size_t begin, UInt128* keys) {
+                    packer.pack(begin, BLOCK_NUM, keys);
+                }, errors);
+        printf("packed UInt128 time: %lfms, keys %zu\n", duration_millsecond, size_t(packed.size()));
+
+        Arena arena;
+        HashTable serialized(10);
+        duration_millsecond = run<HashTable, String>(serialized, build, probe,
+                [&](const KeyPacker<UInt128> &packer, size_t begin, String* keys) {
+                    packer.serialize(begin, BLOCK_NUM, keys, arena);
+                }, errors);
+        printf("serialized time: %lfms, keys %zu\n", duration_millsecond, size_t(serialized.size()));
+    }
+    {
+        /// 8 + 8 + 4 bytes and a null byte do not
+        Rows<uint64_t, uint64_t, uint32_t> build(INSERT_NUM, 1000), probe(FIND_NUM, 1200);
+        KeyPacker<UInt128> packer(build.columns());
+        if (packer.is_packed()) printf("error: 21 byte key packed\n");
+        try {
+            UInt128 key;
+            packer.pack(0, 1, &key);
+            printf("error: pack() of a 21 byte key did not throw\n");
+        } catch (const std::length_error &) {
+        }
+
+        Arena arena;
+        HashTable serialized(10);
+        duration_millsecond = run<HashTable, String>(serialized, build, probe,
+                [&](const KeyPacker<UInt128> &packer, size_t begin, String* keys) {
+                    packer.serialize(begin, BLOCK_NUM, keys, arena);
+                }, errors);
+        printf("wide serialized time: %lfms, keys %zu\n", duration_millsecond, size_t(serialized.size()));
+    }
+    printf("errors: %lu\n", errors);
+}
@@ -0,0 +1,36 @@
+#include <random>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "new_hash_table.h"
+
+/// build time of a table that grows through every resize from 2^10 cells,
+/// with the rehash of the large resizes spread over 1 to 8 threads
+
+const size_t INSERT_NUM = 4000000;
+const uint32_t THREADS[] = {1, 2, 4, 8};
+
+std::mt19937 rng(1337);
+
+int main() {
+    std::vector<String> keys;
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        const auto p = new char[64];
+        for (auto j = 0; j < 64; j++) {
+            p[j] = rng() % (1 << 8);
+        }
+        keys.emplace_back(p);
+    }
+    printf("info: %u hardware threads\n", std::thread::hardware_concurrency());
+    for (auto num_threads : THREADS) {
+        HashTable hashtable(10);
+        hashtable.set_resize_threads(num_threads);
+        auto inserttimeS = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < INSERT_NUM; i++) {
+            hashtable.insert(keys[i], RowRef(i, 0));
+        }
+        auto inserttimeE = std::chrono::steady_clock::now();
+        double duration_millsecond = std::chrono::duration<double, std::milli>(inserttimeE - inserttimeS).count();
+        printf("resize threads %u insert time: %lfms\n", num_threads, duration_millsecond);
+    }
+}
@@ -0,0 +1,75 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include "new_hash_table.h"
+#include "perfect_hash_table.h"
+
+/// build a dimension table once, finalize it into a PerfectHashTable and
+/// compare probe time with the chained table it came from
+
+const size_t INSERT_NUM = 1000000;
+const size_t FIND_NUM = 10000000;
+const uint32_t BLOCK_NUM = 64;
+
+std::mt19937 rng(1337);
+
+template <typename Table>
+double probe(Table &hashtable, std::vector<String> &probes, uint64_t &found) {
+    auto findtimeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < probes.size(); i += BLOCK_NUM) {
+        auto res = hashtable.m_find(probes.data() + i, BLOCK_NUM);
+        for (auto j = 0; j < BLOCK_NUM; j++) {
+            found += res[j] != 0;
+        }
+        delete[] res;
+    }
+    auto findtimeE = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(findtimeE - findtimeS).count();
+}
+
+int main() {
+    std::vector<String> keys;
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        const auto p = new char[64];
+        for (auto j = 0; j < 64; j++) {
+            p[j] = rng() % (1 << 8);
+        }
+        keys.emplace_back(p);
+    }
+    std::vector<String> probes;
+    for (size_t i = 0; i < FIND_NUM; i++) {
+        if (rng() % 2) {
+            probes.emplace_back(keys[rng() % INSERT_NUM]);
+            continue;
+        }
+        const auto p = new char[64];
+        for (auto j = 0; j < 64; j++) {
+            p[j] = rng() % (1 << 8);
+        }
+        probes.emplace_back(p);
+    }
+    double duration_millsecond;
+
+    HashTable hashtable(10);
+    auto inserttimeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        hashtable.insert(keys[i], RowRef(i, 0));
+    }
+    auto inserttimeE = std::chrono::steady_clock::now();
+    duration_millsecond = std::chrono::duration<double, std::milli>(inserttimeE - inserttimeS).count();
+    printf("insert time: %lfms\n", duration_millsecond);
+
+    uint64_t found = 0;
+    duration_millsecond = probe(hashtable, probes, found);
+    printf("chained find time: %lfms, found %lu\n", duration_millsecond, found);
+
+    auto finalizetimeS = std::chrono::steady_clock::now();
+    PerfectHashTable<String> perfect(hashtable);
+    auto finalizetimeE = std::chrono::steady_clock::now();
+    duration_millsecond = std::chrono::duration<double, std::milli>(finalizetimeE - finalizetimeS).count();
+    printf("finalize time: %lfms, index %lu bytes\n", duration_millsecond, perfect.index_bytes());
+
+    found = 0;
+    duration_millsecond = probe(perfect, probes, found);
+    printf("perfect find time: %lfms, found %lu\n", duration_millsecond, found);
+}
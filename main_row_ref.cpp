@@ -0,0 +1,49 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include "new_hash_table.h"
+
+/// memory per row and iteration cost of RowRefList for build sides with
+/// 1 to 256 rows per key, rows arrive round robin over the keys as in a
+/// join build. The 7 slot column is what fixed batches of 7 padded
+/// RowRefs (72 bytes each) would take for the same lists.
+
+const size_t ROW_NUM = 1 << 24;
+const uint32_t ROWS_PER_KEY[] = {1, 2, 3, 5, 8, 16, 50, 256, 1000};
+
+int main() {
+    printf("rows/key  bytes/row  7 slot bytes/row  iterate ns/row\n");
+    for (auto rows_per_key : ROWS_PER_KEY) {
+        size_t key_num = ROW_NUM / rows_per_key;
+        std::vector<RowRefList> lists;
+        lists.reserve(key_num);
+        for (size_t i = 0; i < key_num; i++) {
+            lists.emplace_back(i, 0);
+        }
+        for (uint32_t j = 1; j < rows_per_key; j++) {
+            for (size_t i = 0; i < key_num; i++) {
+                lists[i].insert(RowRef(i + j * key_num, j % 256));
+            }
+        }
+
+        size_t bytes = sizeof(RowRefList) * key_num;
+        for (auto &list : lists) {
+            bytes += list.allocated_bytes();
+        }
+        size_t fixed_bytes = (sizeof(RowRefList) + 72 * ((rows_per_key - 1 + 6) / 7)) * key_num;
+
+        uint64_t sum = 0;
+        auto itertimeS = std::chrono::steady_clock::now();
+        for (auto &list : lists) {
+            list.for_each([&](const RowRef &row_ref) { sum += row_ref.row_num + row_ref.block_offset; });
+        }
+        auto itertimeE = std::chrono::steady_clock::now();
+        double duration_nanosecond = std::chrono::duration<double, std::nano>(itertimeE - itertimeS).count();
+
+        printf("%8u  %9.2lf  %16.2lf  %14.2lf  (%lu)\n", rows_per_key, double(bytes) / ROW_NUM,
+               double(fixed_bytes) / ROW_NUM, duration_nanosecond / ROW_NUM, sum % 2);
+        for (auto &list : lists) {
+            list.clear();
+        }
+    }
+}
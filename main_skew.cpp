@@ -0,0 +1,75 @@
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "new_hash_table.h"
+
+/// build time of Zipf skewed build sides, one insert() per row against
+/// m_insert() blocks, which group repeated keys and keep a hot key cache
+
+const size_t DISTINCT_NUM = 1000000;
+const size_t ROW_NUM = 8000000;
+const uint32_t BLOCK_NUM = 1024;
+const double SKEWS[] = {0, 0.8, 1.0, 1.2};
+
+std::mt19937 rng(1337);
+
+/// rows drawn from DISTINCT_NUM keys, key k with weight 1 / (k + 1)^skew
+std::vector<String> zipf_rows(const std::vector<String> &keys, double skew) {
+    std::vector<double> cdf(keys.size());
+    double sum = 0;
+    for (size_t k = 0; k < keys.size(); k++) {
+        sum += 1 / std::pow(k + 1, skew);
+        cdf[k] = sum;
+    }
+    std::uniform_real_distribution<double> dist(0, sum);
+    std::vector<String> rows(ROW_NUM);
+    for (auto &row : rows) {
+        auto k = std::lower_bound(cdf.begin(), cdf.end(), dist(rng)) - cdf.begin();
+        row = keys[std::min<size_t>(k, keys.size() - 1)];
+    }
+    return rows;
+}
+
+int main() {
+    std::vector<String> keys;
+    for (size_t i = 0; i < DISTINCT_NUM; i++) {
+        const auto p = new char[64];
+        for (auto j = 0; j < 64; j++) {
+            p[j] = rng() % (1 << 8);
+        }
+        keys.emplace_back(p);
+    }
+    printf("skew  distinct  insert() ms  m_insert() ms\n");
+    for (auto skew : SKEWS) {
+        auto rows = zipf_rows(keys, skew);
+        std::vector<RowRef> values(ROW_NUM);
+        for (size_t i = 0; i < ROW_NUM; i++) {
+            values[i] = RowRef(i, 0);
+        }
+        double duration_millsecond, block_duration_millsecond;
+        uint32_t distinct;
+        {
+            HashTable hashtable(10);
+            auto inserttimeS = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < ROW_NUM; i++) {
+                hashtable.insert(rows[i], RowRef(i, 0));
+            }
+            auto inserttimeE = std::chrono::steady_clock::now();
+            duration_millsecond = std::chrono::duration<double, std::milli>(inserttimeE - inserttimeS).count();
+            distinct = hashtable.size();
+        }
+        {
+            HashTable hashtable(10);
+            auto inserttimeS = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < ROW_NUM; i += BLOCK_NUM) {
+                hashtable.m_insert(rows.data() + i, values.data() + i, std::min<size_t>(BLOCK_NUM, ROW_NUM - i));
+            }
+            auto inserttimeE = std::chrono::steady_clock::now();
+            block_duration_millsecond = std::chrono::duration<double, std::milli>(inserttimeE - inserttimeS).count();
+            if (hashtable.size() != distinct) printf("error: size %zu != %zu\n", size_t(hashtable.size()), size_t(distinct));
+        }
+        printf("%4.1lf  %8u  %11.1lf  %13.1lf\n", skew, distinct, duration_millsecond, block_duration_millsecond);
+    }
+}
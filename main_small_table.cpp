@@ -0,0 +1,54 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include "new_hash_table.h"
+#include "small_hash_table.h"
+
+/// many tiny joins: each builds a table of a few keys and probes it with
+/// one block, the way a nested join runs per outer row; compare HashTable
+/// with SmallHashTable for build sides of 4, 16 and 32 keys
+
+const size_t JOIN_NUM = 100000;
+const uint32_t PROBE_NUM = 256;
+const uint32_t KEY_NUM = 1024;
+
+std::mt19937 rng(1337);
+
+template <typename Table>
+double run(std::vector<uint64_t> &keys, std::vector<uint64_t> &probes, uint32_t build_size, uint64_t &found) {
+    auto timeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < JOIN_NUM; i++) {
+        auto build = keys.data() + (i * build_size) % (KEY_NUM - build_size);
+        Table hashtable(10);
+        for (uint32_t j = 0; j < build_size; j++) {
+            hashtable.insert(build[j], RowRef(j, 0));
+        }
+        auto res = hashtable.m_find(probes.data() + (i * PROBE_NUM) % (probes.size() - PROBE_NUM), PROBE_NUM);
+        for (auto j = 0; j < PROBE_NUM; j++) {
+            found += res[j] != 0;
+        }
+        delete[] res;
+    }
+    auto timeE = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(timeE - timeS).count();
+}
+
+int main() {
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < KEY_NUM; i++) {
+        keys.push_back((uint64_t(rng()) << 32) | rng());
+    }
+    std::vector<uint64_t> probes;
+    for (size_t i = 0; i < KEY_NUM * 16; i++) {
+        probes.push_back(rng() % 4 ? (uint64_t(rng()) << 32) | rng() : keys[rng() % KEY_NUM]);
+    }
+
+    for (uint32_t build_size : {4, 16, 32}) {
+        uint64_t found = 0;
+        auto duration_millsecond = run<BasicHashTable<uint64_t>>(keys, probes, build_size, found);
+        printf("build %u: chained join time: %lfms, found %lu\n", build_size, duration_millsecond, found);
+        found = 0;
+        duration_millsecond = run<SmallHashTable<uint64_t>>(keys, probes, build_size, found);
+        printf("build %u: small join time: %lfms, found %lu\n", build_size, duration_millsecond, found);
+    }
+}
@@ -0,0 +1,73 @@
+#include <random>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "new_hash_table.h"
+
+/// ns per probe of m_find() on a table far bigger than cache, in arrival
+/// order and sorted by bucket (set_sorted_probe), for growing block sizes
+
+const size_t INSERT_NUM = 12000000;
+const size_t FIND_NUM = 1 << 24;
+const int RUN_NUM = 3;
+const uint32_t BLOCK_SIZES[] = {64, 256, 1024, 4096, 16384, 65536, 262144, 1048576};
+
+std::mt19937_64 rng(1337);
+
+double probe(UInt64HashTable &hashtable, std::vector<uint64_t> &probes, uint32_t block_size, uint64_t &found) {
+    auto findtimeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < probes.size(); i += block_size) {
+        auto res = hashtable.m_find(probes.data() + i, block_size);
+        for (uint32_t j = 0; j < block_size; j++) {
+            found += res[j] != 0;
+        }
+        delete[] res;
+    }
+    auto findtimeE = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(findtimeE - findtimeS).count() / probes.size();
+}
+
+void bench(UInt64HashTable &hashtable, std::vector<uint64_t> &probes);
+
+int main() {
+    std::vector<uint64_t> keys(INSERT_NUM);
+    for (auto &key : keys) {
+        key = rng();
+    }
+    std::vector<uint64_t> probes(FIND_NUM);
+    for (auto &key : probes) {
+        key = rng() % 2 ? keys[rng() % INSERT_NUM] : rng();
+    }
+
+    UInt64HashTable hashtable(10);
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        hashtable.insert(keys[i], RowRef(i, 0));
+    }
+    printf("info: %lu keys, first %lu bytes, buf %lu bytes\n", INSERT_NUM, hashtable.first_bytes(),
+           hashtable.buf_bytes());
+
+    printf("info: cells in insertion order\n");
+    bench(hashtable, probes);
+    auto clustertimeS = std::chrono::steady_clock::now();
+    hashtable.cluster_cells();
+    auto clustertimeE = std::chrono::steady_clock::now();
+    printf("info: cells clustered by bucket in %lfms\n",
+           std::chrono::duration<double, std::milli>(clustertimeE - clustertimeS).count());
+    bench(hashtable, probes);
+}
+
+void bench(UInt64HashTable &hashtable, std::vector<uint64_t> &probes) {
+    printf("block size  unsorted ns/probe  sorted ns/probe\n");
+    for (auto block_size : BLOCK_SIZES) {
+        uint64_t found = 0, sorted_found = 0;
+        double unsorted = 1e9, sorted = 1e9;
+        /// best of RUN_NUM, the runs are short enough for noise to matter
+        for (auto run = 0; run < RUN_NUM; run++) {
+            hashtable.set_sorted_probe(0);
+            unsorted = std::min(unsorted, probe(hashtable, probes, block_size, found));
+            hashtable.set_sorted_probe(1);
+            sorted = std::min(sorted, probe(hashtable, probes, block_size, sorted_found));
+        }
+        printf("%10u  %17.2lf  %15.2lf  %s\n", block_size, unsorted, sorted, found == sorted_found ? "" : "mismatch");
+    }
+}
@@ -0,0 +1,88 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include "string_hash_table.h"
+
+/// StringHashTable, which dispatches keys by length, against the plain
+/// String HashTable on the same rows: every probe must agree on hit and row
+/// count, and the build + probe time of both is printed
+
+const size_t INSERT_NUM = 1000000;
+const size_t FIND_NUM = 4000000;
+const uint32_t BLOCK_NUM = 64;
+
+std::mt19937 rng(1337);
+
+uint64_t errors = 0;
+
+/// lengths in [min_size, max_size], a few bytes end with '\0' to take the
+/// long key path whatever their length
+String random_string(uint32_t min_size, uint32_t max_size) {
+    auto size = min_size + rng() % (max_size - min_size + 1);
+    const auto p = new char[size];
+    for (auto j = 0; j < size; j++) {
+        p[j] = rng() % 64 ? 'a' + rng() % 26 : 0;
+    }
+    return String(p, size);
+}
+
+template <typename Table>
+double run(Table &hashtable, std::vector<String> &keys, std::vector<String> &probes, std::vector<index_t> &res) {
+    auto timeS = std::chrono::steady_clock::now();
+    std::vector<RowRef> values;
+    for (size_t i = 0; i < BLOCK_NUM; i++) {
+        values.emplace_back(i, 0);
+    }
+    for (size_t i = 0; i < keys.size(); i += BLOCK_NUM) {
+        hashtable.m_insert(keys.data() + i, values.data(), std::min<size_t>(BLOCK_NUM, keys.size() - i));
+    }
+    for (size_t i = 0; i < probes.size(); i += BLOCK_NUM) {
+        auto block_res = hashtable.m_find(probes.data() + i, BLOCK_NUM);
+        std::copy(block_res, block_res + BLOCK_NUM, res.begin() + i);
+        delete[] block_res;
+    }
+    auto timeE = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(timeE - timeS).count();
+}
+
+void compare(const char* name, size_t distinct, uint32_t min_size, uint32_t max_size) {
+    std::vector<String> values, keys, probes;
+    for (size_t i = 0; i < distinct; i++) {
+        values.push_back(random_string(min_size, max_size));
+    }
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        keys.push_back(values[rng() % distinct]);
+    }
+    for (size_t i = 0; i < FIND_NUM; i++) {
+        probes.push_back(rng() % 2 ? values[rng() % distinct] : random_string(min_size, max_size));
+    }
+
+    StringHashTable by_length(10);
+    HashTable plain(10);
+    std::vector<index_t> by_length_res(FIND_NUM), plain_res(FIND_NUM);
+    auto by_length_time = run(by_length, keys, probes, by_length_res);
+    auto plain_time = run(plain, keys, probes, plain_res);
+    printf("== %s\nby length time: %lfms\nplain time: %lfms\n", name, by_length_time, plain_time);
+
+    if (by_length.size() != plain.size()) {
+        printf("error: size %zu != %zu\n", size_t(by_length.size()), size_t(plain.size()));
+        ++errors;
+    }
+    for (size_t i = 0; i < FIND_NUM; i++) {
+        auto by_length_pos = by_length_res[i];
+        auto plain_pos = plain_res[i];
+        if (!by_length_pos != !plain_pos || (plain_pos && by_length.get(by_length_pos - 1)->get_row_count() !=
+                                                           plain.get(plain_pos - 1)->get_row_count())) {
+            printf("error: probe %zu of size %u disagrees\n", i, uint32_t(probes[i].size()));
+            if (++errors > 10) exit(0);
+        }
+    }
+}
+
+int main() {
+    compare("up to 8 bytes", 100000, 1, 8);
+    compare("9 to 24 bytes", 100000, 9, 24);
+    compare("1 to 64 bytes", 100000, 1, 64);
+    compare("25 to 64 bytes", 100000, 25, 64);
+    printf("errors: %lu\n", errors);
+}
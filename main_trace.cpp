@@ -0,0 +1,90 @@
+#ifndef HASH_TABLE_TRACING
+#define HASH_TABLE_TRACING
+#endif
+#include <random>
+#include <chrono>
+#include <vector>
+#include "new_hash_table.h"
+
+/// a profiler side of the tracing hooks: time spent per phase of a block
+/// build and probe, resizes and memory, taken from trace events only
+
+const size_t INSERT_NUM = 1 << 21;
+const size_t FIND_NUM = 1 << 22;
+const uint32_t BLOCK_NUM = 1024;
+
+std::mt19937 rng(1337);
+
+struct PhaseProfile {
+    std::chrono::steady_clock::time_point begin[4];
+    double milliseconds[4] = {};
+    uint64_t resizes = 0;
+    uint64_t batch_allocs = 0;
+    uint64_t batch_bytes = 0;
+    uint64_t peak_bytes = 0;
+} profile;
+
+const char* PHASES[] = {"resize", "hash", "probe", "insert"};
+
+void trace_hook(TraceEvent event, const void*, uint64_t a, uint64_t) {
+    auto now = std::chrono::steady_clock::now();
+    auto phase = [&](int i, bool begin) {
+        if (begin) {
+            profile.begin[i] = now;
+        } else {
+            profile.milliseconds[i] += std::chrono::duration<double, std::milli>(now - profile.begin[i]).count();
+        }
+    };
+    switch (event) {
+        case TraceEvent::RESIZE_BEGIN: ++profile.resizes; phase(0, true); break;
+        case TraceEvent::RESIZE_END: phase(0, false); break;
+        case TraceEvent::HASH_BEGIN: phase(1, true); break;
+        case TraceEvent::HASH_END: phase(1, false); break;
+        case TraceEvent::PROBE_BEGIN: phase(2, true); break;
+        case TraceEvent::PROBE_END: phase(2, false); break;
+        case TraceEvent::INSERT_BEGIN: phase(3, true); break;
+        case TraceEvent::INSERT_END: phase(3, false); break;
+        case TraceEvent::ALLOC: profile.peak_bytes = std::max(profile.peak_bytes, a); break;
+        case TraceEvent::FREE: break;
+        case TraceEvent::BATCH_ALLOC: ++profile.batch_allocs; profile.batch_bytes += a; break;
+    }
+}
+
+int main() {
+    std::vector<String> keys;
+    for (size_t i = 0; i < INSERT_NUM / 4; i++) {
+        const auto p = new char[64];
+        for (auto j = 0; j < 64; j++) {
+            p[j] = rng() % (1 << 8);
+        }
+        keys.emplace_back(p);
+    }
+    std::vector<String> rows(INSERT_NUM);
+    std::vector<RowRef> values(INSERT_NUM);
+    for (size_t i = 0; i < INSERT_NUM; i++) {
+        rows[i] = keys[rng() % keys.size()];
+        values[i] = RowRef(i, 0);
+    }
+    std::vector<String> probes(FIND_NUM);
+    for (auto &probe : probes) {
+        probe = keys[rng() % keys.size()];
+    }
+
+    hash_table_trace_hook = trace_hook;
+    HashTable hashtable(10);
+    auto timeS = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < INSERT_NUM; i += BLOCK_NUM) {
+        hashtable.m_insert(rows.data() + i, values.data() + i, BLOCK_NUM);
+    }
+    for (size_t i = 0; i < FIND_NUM; i += BLOCK_NUM) {
+        delete[] hashtable.m_find(probes.data() + i, BLOCK_NUM);
+    }
+    auto timeE = std::chrono::steady_clock::now();
+    printf("total time: %lfms\n", std::chrono::duration<double, std::milli>(timeE - timeS).count());
+    /// insert includes the resizes it triggered
+    for (auto i = 0; i < 4; i++) {
+        printf("%s time: %lfms\n", PHASES[i], profile.milliseconds[i]);
+    }
+    printf("resizes: %lu, peak table bytes: %lu\n", profile.resizes, profile.peak_bytes);
+    printf("batch allocs: %lu, batch bytes: %lu\n", profile.batch_allocs, profile.batch_bytes);
+}
@@ -0,0 +1,134 @@
+#include <random>
+#include <chrono>
+#include <vector>
+#include <thread>
+#include <unordered_map>
+#include "two_level_hash_table.h"
+
+/// AutoTwoLevelHashTable growing past its conversion threshold: the table
+/// must still agree with a reference after the single level cells moved to
+/// the sub-tables, and the build + probe time is printed against the single
+/// level UInt64HashTable. Then the rows are split over thread-local tables,
+/// and merge_thread_local must give the same table as one single threaded
+/// build.
+
+const size_t INSERT_NUM = 4000000;
+const size_t FIND_NUM = 4000000;
+const uint32_t BLOCK_NUM = 64;
+const uint32_t CONVERSION_THRESHOLD = 1 << 18;
+const uint32_t THREAD_NUM = 4;
+
+std::mt19937 rng(1337);
+
+uint64_t errors = 0;
+
+uint64_t random_uint64() {
+    return (uint64_t(rng()) << 32) | rng();
+}
+
+template <typename Table>
+void check(const char* name, Table &hashtable, const std::unordered_map<uint64_t, uint32_t> &reference,
+           std::vector<uint64_t> &probes) {
+    if (hashtable.size() != reference.size()) {
+        printf("error: %s size %zu != %zu\n", name, size_t(hashtable.size()), reference.size());
+        ++errors;
+    }
+    for (size_t i = 0; i < probes.size(); i += BLOCK_NUM) {
+        auto res = hashtable.m_find(probes.data() + i, BLOCK_NUM);
+        for (auto j = 0; j < BLOCK_NUM; j++) {
+            auto it = reference.find(probes[i + j]);
+            if (it == reference.end() ? res[j] != 0
+                                      : res[j] == 0 || hashtable.get(res[j] - 1)->get_row_count() != it->second) {
+                printf("error: %s key %lu found at %zu\n", name, probes[i + j], size_t(res[j]));
+                if (++errors > 10) exit(0);
+            }
+        }
+        delete[] res;
+    }
+}
+
+template <typename Table>
+double run(Table &hashtable, std::vector<uint64_t> &keys, std::vector<uint64_t> &probes) {
+    auto timeS = std::chrono::steady_clock::now();
+    std::vector<RowRef> values;
+    for (size_t i = 0; i < BLOCK_NUM; i++) {
+        values.emplace_back(i, 0);
+    }
+    for (size_t i = 0; i < keys.size(); i += BLOCK_NUM) {
+        hashtable.m_insert(keys.data() + i, values.data(), BLOCK_NUM);
+    }
+    for (size_t i = 0; i < probes.size(); i += BLOCK_NUM) {
+        delete[] hashtable.m_find(probes.data() + i, BLOCK_NUM);
+    }
+    auto timeE = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(timeE - timeS).count();
+}
+
+int main() {
+    std::vector<uint64_t> values(INSERT_NUM / 4);
+    for (auto &value : values) {
+        value = random_uint64();
+    }
+    std::vector<uint64_t> keys(INSERT_NUM), probes(FIND_NUM);
+    std::unordered_map<uint64_t, uint32_t> reference;
+    for (auto &key : keys) {
+        key = values[rng() % values.size()];
+        ++reference[key];
+    }
+    for (auto &probe : probes) {
+        probe = rng() % 2 ? values[rng() % values.size()] : random_uint64();
+    }
+
+    AutoTwoLevelHashTable<uint64_t> auto_two_level(10, CONVERSION_THRESHOLD);
+    printf("auto two level time: %lfms\n", run(auto_two_level, keys, probes));
+    if (!auto_two_level.is_two_level()) {
+        printf("error: %zu keys did not convert\n", reference.size());
+        ++errors;
+    }
+    check("auto two level", auto_two_level, reference, probes);
+
+    UInt64HashTable single_level(10);
+    printf("single level time: %lfms\n", run(single_level, keys, probes));
+    TwoLevelHashTable<uint64_t> converted(single_level);
+    if (single_level.size() != 0) {
+        printf("error: converted single level table kept %zu keys\n", size_t(single_level.size()));
+        ++errors;
+    }
+    check("converted", converted, reference, probes);
+
+    /// thread t builds the blocks t, t + THREAD_NUM, ... of the rows
+    std::vector<UInt64HashTable*> locals;
+    for (uint32_t t = 0; t < THREAD_NUM; t++) {
+        locals.push_back(new UInt64HashTable(10));
+    }
+    auto mergetimeS = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < THREAD_NUM; t++) {
+        threads.emplace_back([&, t] {
+            std::vector<RowRef> values;
+            for (size_t i = 0; i < BLOCK_NUM; i++) {
+                values.emplace_back(i, 0);
+            }
+            for (size_t i = t * BLOCK_NUM; i < keys.size(); i += THREAD_NUM * BLOCK_NUM) {
+                locals[t]->m_insert(keys.data() + i, values.data(), BLOCK_NUM);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    auto merged = merge_thread_local(locals, THREAD_NUM);
+    auto mergetimeE = std::chrono::steady_clock::now();
+    printf("thread local build + merge time: %lfms\n",
+           std::chrono::duration<double, std::milli>(mergetimeE - mergetimeS).count());
+    for (auto local : locals) {
+        if (local->size() != 0) {
+            printf("error: merged thread local table kept %zu keys\n", size_t(local->size()));
+            ++errors;
+        }
+        delete local;
+    }
+    check("merged", *merged, reference, probes);
+    delete merged;
+    printf("errors: %lu\n", errors);
+}
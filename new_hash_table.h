@@ -1,171 +1,523 @@
 #pragma once 
 #include <algorithm>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 #include "String.h"
+#include "column_view.h"
+#include "inline_string.h"
+#include "packed_key.h"
+#include "table_allocator.h"
+#include "trace.h"
 #include "xxhash32.h"
 
+/// Cell positions, row numbers and block ids. Build with
+/// -DHASH_TABLE_WIDE_INDEX for build sides past 4G cells or rows, or past
+/// 256 blocks: they become 64, 64 and 16 bits wide. The compact 32, 32 and
+/// 8 bit layout is the default. BasicHashTable, RowRefList and the tables
+/// wrapping BasicHashTable widen; RobinHoodHashTable, CuckooHashTable,
+/// PerfectHashTable and ConcurrentHashTable keep their 32 bit positions.
+#ifdef HASH_TABLE_WIDE_INDEX
+using index_t = uint64_t;
+using row_num_t = uint64_t;
+using block_offset_t = uint16_t;
+#else
+using index_t = uint32_t;
+using row_num_t = uint32_t;
+using block_offset_t = uint8_t;
+#endif
+
 struct RowRef {
-    using SizeT = uint32_t;
+    using SizeT = row_num_t;
     SizeT row_num = 0;
-    uint8_t block_offset;
+    block_offset_t block_offset;
 
     RowRef() {}
-    RowRef(size_t row_num_count, uint8_t block_offset_)
+    RowRef(size_t row_num_count, block_offset_t block_offset_)
             : row_num(row_num_count), block_offset(block_offset_) {}
+
+    bool operator==(const RowRef& other) const {
+        return row_num == other.row_num && block_offset == other.block_offset;
+    }
+};
+
+/// RowRef as stored in RowRefList batches: 5 bytes instead of 8 (10
+/// instead of 16 with wide indexes), the padding after block_offset is
+/// what a packed layout saves
+struct __attribute__((packed)) PackedRowRef {
+    row_num_t row_num;
+    block_offset_t block_offset;
+
+    PackedRowRef() {}
+    PackedRowRef(const RowRef& row_ref) : row_num(row_ref.row_num), block_offset(row_ref.block_offset) {}
+
+    operator RowRef() const { return RowRef(row_num, block_offset); }
 };
 
 struct RowRefList : RowRef {
+    /// Batches grow geometrically, MIN_CAPACITY refs for the first one and
+    /// half as many again as the previous one after it, up to MAX_CAPACITY.
+    /// A key with one extra row pays a 36 byte batch, and the free slots of
+    /// a long list are all in its newest batch.
     struct Batch {
-        static constexpr size_t MAX_SIZE = 7;
+        static constexpr uint32_t MIN_CAPACITY = 4;
+        static constexpr uint32_t MAX_CAPACITY = 1024;
 
-        SizeT size = 0; 
         Batch* next;
-        RowRef row_refs[MAX_SIZE];
+        uint32_t size = 0;
+        uint32_t capacity;
+        /// capacity refs follow the header, bytes() sizes the allocation
+        PackedRowRef row_refs[1];
 
-        Batch(Batch* parent) : next(parent) {}
+        static Batch* create(Batch* parent, uint32_t capacity_) {
+            auto batch = static_cast<Batch*>(::operator new(bytes(capacity_)));
+            HASH_TABLE_TRACE(BATCH_ALLOC, nullptr, bytes(capacity_), 0);
+            batch->next = parent;
+            batch->size = 0;
+            batch->capacity = capacity_;
+            return batch;
+        }
+        static void destroy(Batch* batch) { ::operator delete(batch); }
+        static size_t bytes(uint32_t capacity_) {
+            return offsetof(Batch, row_refs) + sizeof(PackedRowRef) * capacity_;
+        }
 
-        bool full() const { return size == MAX_SIZE; }
+        bool full() const { return size == capacity; }
 
         Batch* insert(RowRef&& row_ref) {
             if (full()) {
-                auto batch = new Batch(this);
+                auto batch = create(this, std::min(capacity + capacity / 2, MAX_CAPACITY));
                 batch->insert(std::move(row_ref));
                 return batch;
             }
 
-            row_refs[size++] = std::move(row_ref);
+            row_refs[size++] = row_ref;
             return this;
         }
     };
 
     RowRefList() {}
-    RowRefList(size_t row_num_, uint8_t block_offset_) : RowRef(row_num_, block_offset_) {}
+    RowRefList(size_t row_num_, block_offset_t block_offset_) : RowRef(row_num_, block_offset_) {}
 
     void insert(RowRef&& row_ref) {
         row_count++;
 
         if (!next) {
-            next = new Batch (nullptr);
+            next = Batch::create(nullptr, Batch::MIN_CAPACITY);
         }
         next = next->insert(std::move(row_ref));
     }
 
-    uint32_t get_row_count() { return row_count; }
+    SizeT get_row_count() { return row_count; }
+
+    /// call func with every RowRef, the inline one first
+    template <typename Func>
+    void for_each(Func&& func) const {
+        if (!row_count) return;
+        func(static_cast<const RowRef&>(*this));
+        for (auto batch = next; batch; batch = batch->next) {
+            for (SizeT i = 0; i < batch->size; ++i) {
+                func(RowRef(batch->row_refs[i]));
+            }
+        }
+    }
+
+    /// heap bytes held by the batches
+    size_t allocated_bytes() const {
+        size_t res = 0;
+        for (auto batch = next; batch; batch = batch->next) {
+            res += Batch::bytes(batch->capacity);
+        }
+        return res;
+    }
+
+    /// remove one RowRef, the last inserted one takes its place.
+    /// row_count drops to 0 when the inline RowRef was the only one left.
+    bool erase(const RowRef& row_ref) {
+        RowRef* target = nullptr;
+        PackedRowRef* packed_target = nullptr;
+        if (*this == row_ref) {
+            target = this;
+        }
+        for (auto batch = next; batch && !target && !packed_target; batch = batch->next) {
+            for (SizeT i = 0; i < batch->size; ++i) {
+                if (RowRef(batch->row_refs[i]) == row_ref) {
+                    packed_target = &batch->row_refs[i];
+                    break;
+                }
+            }
+        }
+        if (!target && !packed_target) return false;
+
+        --row_count;
+        if (next) {
+            PackedRowRef last = next->row_refs[--next->size];
+            if (target) {
+                *target = last;
+            } else {
+                *packed_target = last;
+            }
+            if (!next->size) {
+                auto parent = next->next;
+                Batch::destroy(next);
+                next = parent;
+            }
+        }
+        return true;
+    }
+
+    /// move the RowRefs of other into this list. Its batches are linked in
+    /// front of ours rather than copied, so a batch in the middle of the
+    /// chain may be partly filled. other keeps only its inline RowRef.
+    void splice(RowRefList& other) {
+        if (other.next) {
+            auto tail = other.next;
+            while (tail->next) {
+                tail = tail->next;
+            }
+            tail->next = next;
+            next = other.next;
+            row_count += other.row_count - 1;
+            other.next = nullptr;
+            other.row_count = 1;
+        }
+        insert(RowRef(other.row_num, other.block_offset));
+    }
+
+    /// free the batches, the inline RowRef stays
+    void clear() {
+        while (next) {
+            auto parent = next->next;
+            Batch::destroy(next);
+            next = parent;
+        }
+        row_count = 1;
+    }
 
 private:
     Batch* next = nullptr;
-    uint32_t row_count = 1;
+    SizeT row_count = 1;
 };
 
+/// Threads that the parallel rehash of BasicHashTable keeps across the
+/// resizes of a table, so a build does not start new threads each time.
+class ResizeWorkers {
+public:
+    explicit ResizeWorkers(uint32_t num_workers) {
+        for (uint32_t i = 0; i < num_workers; ++i) {
+            threads.emplace_back([this] { work(); });
+        }
+    }
+    ResizeWorkers(const ResizeWorkers&) = delete;
+    ResizeWorkers& operator=(const ResizeWorkers&) = delete;
+    ~ResizeWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stop = true;
+        }
+        task_ready.notify_all();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    uint32_t size() const { return threads.size(); }
 
+    /// calls task(i) for every i in [0, num_tasks) on the workers and the
+    /// calling thread, returns once all calls finished
+    void run(uint32_t num_tasks, const std::function<void(uint32_t)> &task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &task;
+            next_task = 0;
+            tasks = pending = num_tasks;
+            ++generation;
+        }
+        task_ready.notify_all();
+        help();
+        std::unique_lock<std::mutex> lock(mutex);
+        tasks_done.wait(lock, [this] { return pending == 0; });
+    }
 
-class HashTable {
+private:
+    void work() {
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                task_ready.wait(lock, [&] { return stop || generation != seen; });
+                if (stop) return;
+                seen = generation;
+            }
+            help();
+        }
+    }
+
+    /// take tasks until none are left; run() waits for the taken ones, so
+    /// current outlives every call
+    void help() {
+        while (true) {
+            const std::function<void(uint32_t)>* task;
+            uint32_t index;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (next_task >= tasks) return;
+                task = current;
+                index = next_task++;
+            }
+            (*task)(index);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) tasks_done.notify_all();
+        }
+    }
+
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable task_ready;
+    std::condition_variable tasks_done;
+    const std::function<void(uint32_t)>* current = nullptr;
+    uint64_t generation = 0;
+    uint32_t next_task = 0;
+    uint32_t tasks = 0;
+    uint32_t pending = 0;
+    bool stop = false;
+};
+
+/// hash of String-like keys, fixed size keys hash in packed_key.h
+template <typename T>
+inline uint32_t hash_key(const T &key) {
+    return XXHash32::hash(key.data(), key.size(), 0);
+}
+
+/// Key is the lookup key, CellKey is how it is stored in buf: String keeps
+/// only the pointer, InlineString<N> keeps short keys and long key prefixes
+/// inside the cell. Fixed size keys are stored as they are.
+/// Allocator provides buf/first/next, see table_allocator.h.
+/// Mapped is RowRefList for joins; other mapped types (aggregate state
+/// pointers) go through emplace() and must be trivially relocatable.
+template <typename Key, typename CellKey = Key, typename Allocator = HeapAllocator, typename Mapped = RowRefList>
+class BasicHashTable {
 public:
-    using key_t = String;
-    using Cell = std::pair<key_t, RowRefList>;
-    HashTable(uint32_t size) {
+    using key_t = Key;
+    using mapped_t = Mapped;
+    using Cell = std::pair<CellKey, Mapped>;
+    BasicHashTable(uint32_t size) {
         m_size = 0;
         degree = size;
-        buf = new Cell[buf_size()];
+        buf = static_cast<Cell*>(Allocator::alloc(buf_bytes()));
 
-        first = new uint32_t[bucket_size()];
-        next = new uint32_t[buf_size() + 1];
+        first = static_cast<index_t*>(Allocator::alloc(first_bytes()));
+        next = static_cast<index_t*>(Allocator::alloc(next_bytes()));
+        HASH_TABLE_TRACE(ALLOC, this, allocated_bytes(), 0);
     }
-    ~HashTable() {
+    ~BasicHashTable() {
+        for (index_t i = 0; i < m_size; ++i) {
+            destroy_mapped(buf[i].second);
+        }
         m_size = 0;
+        HASH_TABLE_TRACE(FREE, this, allocated_bytes(), 0);
         if (buf) {
-            delete buf;
+            Allocator::free(buf, buf_bytes());
             buf = nullptr;
         }
         if (first) {
-            delete first;
+            Allocator::free(first, first_bytes());
             first = nullptr;
         }
         if (next) {
-            delete next;
+            Allocator::free(next, next_bytes());
             next = nullptr;
         }
+        delete resize_workers;
     }
     void insert(const key_t &key, RowRef && value) {
-        auto place_value = find(key);
-        //printf("debug: insert -> find place_value %u, m_size %u\n", place_value, m_size);
-        if (place_value) {
-            auto block = &buf[place_value - 1];
-            block->second.insert(std::move(value));
-            return;
+        insert(key, hash(key), std::move(value));
+    }
+
+    /// insert with block, a key repeated within the block lands in one cell
+    void m_insert(key_t* keys, RowRef* values, unsigned int block_size) {
+        std::vector<uint32_t> hash_values(block_size);
+        HASH_TABLE_TRACE(HASH_BEGIN, this, block_size, 0);
+        for (uint32_t i = 0; i < block_size; ++i) {
+            hash_values[i] = hash(keys[i]);
         }
-        new (&buf[m_size]) Cell(key, RowRefList(value.row_num, value.block_offset));
-        ++m_size;
-        auto hash_value = hash(key);
-        auto bucket_value = hash_value & mask();
-        
-        next[m_size] = first[bucket_value];
-        first[bucket_value] = m_size;
+        HASH_TABLE_TRACE(HASH_END, this, block_size, 0);
+        m_insert(keys, hash_values.data(), values, block_size);
+    }
+    index_t find(const key_t &key) {
+        return find(key, hash(key));
+    }
 
-        if (is_full()) {
-            resize();
+    /// find with block
+    index_t* m_find(key_t* keys, uint32_t block_size) {
+        auto* res = new index_t[block_size];
+        m_find_column(keys, 0, block_size, res);
+        return res;
+    }
+
+    /// Overloads taking precomputed hashes, so the hash a pipeline already
+    /// computed for partitioning or runtime filters serves the lookup too.
+    /// Contract: hash_value must equal hash(key), i.e. hash_key(key) -
+    /// XXHash32 with seed 0 over the key bytes for String keys, the murmur3
+    /// finalizer for integer and packed keys (packed_key.h). Buckets use the
+    /// low bits and TwoLevelHashTable the top 8 bits, so partition on the
+    /// remaining high bits to keep both uniform within a partition.
+    void insert(const key_t &key, uint32_t hash_value, RowRef && value) {
+        auto [place_value, inserted] = emplace(key, hash_value);
+        auto row_refs = &buf[place_value - 1].second;
+        if (inserted) {
+            new (row_refs) RowRefList(value.row_num, value.block_offset);
+        } else {
+            row_refs->insert(std::move(value));
         }
     }
 
-    /// insert with block
-    void m_insert(key_t* keys, RowRef* values, unsigned int block_size) {
-        std::vector<uint32_t> index_list;
-        for (auto i = 0; i < block_size; ++i) {
-            auto place_value = find(keys[i]);
-            if (place_value) {
-                auto block = &buf[place_value - 1];
-                block->second.insert(std::move(values[i]));
+    /// Duplicates within the block are grouped first, so each distinct key
+    /// is looked up once and its RowRefs are appended together, in block
+    /// order. Keys repeated within a block go to the hot key cache, later
+    /// blocks find them there without walking their chain.
+    void m_insert(key_t* keys, const uint32_t* hash_values, RowRef* values, unsigned int block_size) {
+        HASH_TABLE_TRACE(INSERT_BEGIN, this, block_size, m_size);
+        uint32_t group_mask = 1;
+        while (group_mask < block_size * 2) {
+            group_mask <<= 1;
+        }
+        --group_mask;
+        /// open addressing over the block: index + 1 of the first row of each key
+        std::vector<uint32_t> group_heads(group_mask + 1, 0);
+        /// next row of the same key, block_size ends a group
+        std::vector<uint32_t> group_next(block_size, block_size);
+        std::vector<uint32_t> group_tails(block_size);
+        std::vector<uint32_t> distinct;
+        distinct.reserve(block_size);
+        for (uint32_t i = 0; i < block_size; ++i) {
+            auto slot = hash_values[i] & group_mask;
+            while (group_heads[slot]) {
+                auto head = group_heads[slot] - 1;
+                if (hash_values[head] == hash_values[i] && keys[head] == keys[i]) break;
+                slot = (slot + 1) & group_mask;
+            }
+            if (group_heads[slot]) {
+                auto head = group_heads[slot] - 1;
+                group_next[group_tails[head]] = i;
+                group_tails[head] = i;
             } else {
-                index_list.emplace_back(i);
+                group_heads[slot] = i + 1;
+                group_tails[i] = i;
+                distinct.push_back(i);
             }
         }
-        for (auto i : index_list) {
-            new (&buf[m_size]) Cell(keys[i], RowRefList(values[i].row_num, values[i].block_offset));
-            ++m_size;
-            if (is_full()) {
-                resize();
-                continue;
+        for (auto i : distinct) {
+            auto repeated = group_next[i] != block_size;
+            auto place_value = find_hot(keys[i], hash_values[i]);
+            RowRefList* row_refs;
+            if (place_value) {
+                row_refs = &buf[place_value - 1].second;
+                row_refs->insert(std::move(values[i]));
+            } else {
+                bool inserted;
+                std::tie(place_value, inserted) = emplace(keys[i], hash_values[i]);
+                row_refs = &buf[place_value - 1].second;
+                if (inserted) {
+                    new (row_refs) RowRefList(values[i].row_num, values[i].block_offset);
+                } else {
+                    row_refs->insert(std::move(values[i]));
+                }
+                if (repeated) {
+                    hot_keys[hot_slot(hash_values[i])] = {hash_values[i], place_value};
+                }
+            }
+            for (auto j = group_next[i]; j != block_size; j = group_next[j]) {
+                row_refs->insert(std::move(values[j]));
             }
-            auto hash_value = hash(keys[i]);
-            auto bucket_value = hash_value & mask();
-
-            next[m_size] = first[bucket_value];
-            first[bucket_value] = m_size;
         }
+        HASH_TABLE_TRACE(INSERT_END, this, block_size, m_size);
     }
-    uint32_t find(key_t key) {
-        auto hash_value = hash(key);
+
+    index_t find(const key_t &key, uint32_t hash_value) {
         auto bucket_value = hash_value & mask();
         auto place_value = first[bucket_value];
         while (place_value && buf[place_value - 1].first != key) {
             ++collision_num;
-            place_value = next[place_value];       
+            place_value = next[place_value];
         }
         return place_value;
     }
 
-    /// find with block
-    uint32_t* m_find(key_t* keys, uint32_t block_size) {
-        auto* res = new uint32_t[block_size];
-        std::vector<std::tuple<uint32_t, uint32_t>> place_values;
-        std::vector<std::tuple<uint32_t, uint32_t>> place_values_new;
+    index_t* m_find(key_t* keys, const uint32_t* hash_values, uint32_t block_size) {
+        auto* res = new index_t[block_size];
+        m_find_column(keys, 0, block_size, res, hash_values);
+        return res;
+    }
+
+    /// the key is hashed once and its chain walked once, a miss links the
+    /// new cell at the head of the chain it was looked up in
+    std::pair<index_t, bool> emplace(const key_t &key, uint32_t hash_value) {
+        auto bucket_value = hash_value & mask();
+        auto place_value = first[bucket_value];
+        while (place_value && buf[place_value - 1].first != key) {
+            ++collision_num;
+            place_value = next[place_value];
+        }
+        if (place_value) {
+            return {place_value, false};
+        }
+        new (&buf[m_size]) Cell(key, Mapped());
+        ++m_size;
+        next[m_size] = first[bucket_value];
+        first[bucket_value] = m_size;
+        place_value = m_size;
+        if (is_full()) {
+            resize();
+        }
+        return {place_value, true};
+    }
+
+    /// build from rows [begin, begin + block_size) of a key column (see
+    /// column_view.h), row r is stored as RowRef(r, block_offset)
+    template <typename Column>
+    void m_insert_column(const Column &column, size_t begin, uint32_t block_size, block_offset_t block_offset) {
+        for (size_t row = begin; row < begin + block_size; ++row) {
+            insert(column_key(column, row), RowRef(row, block_offset));
+        }
+    }
+
+    /// probe rows [begin, begin + block_size) of a key column,
+    /// res[i] is the find() position of row begin + i.
+    /// hash_values[i], when given, is the precomputed hash of row begin + i
+    template <typename Column>
+    void m_find_column(const Column &column, size_t begin, uint32_t block_size, index_t* res,
+                       const uint32_t* hash_values = nullptr) {
+        if (sorted_probe_block_size && block_size >= sorted_probe_block_size) {
+            m_find_column_sorted(column, begin, block_size, res, hash_values);
+            return;
+        }
+        std::vector<std::tuple<uint32_t, index_t>> place_values;
+        std::vector<std::tuple<uint32_t, index_t>> place_values_new;
+        place_values.reserve(block_size);
+        HASH_TABLE_TRACE(HASH_BEGIN, this, block_size, 0);
         for (auto i = 0; i < block_size; i++) {
-            auto hash_value = hash(keys[i]);
+            auto hash_value = hash_values ? hash_values[i] : hash(column_key(column, begin + i));
             auto bucket_value = hash_value & mask();
             auto place_value = first[bucket_value];
             place_values.emplace_back(i, place_value);
         }
+        HASH_TABLE_TRACE(HASH_END, this, block_size, 0);
+        HASH_TABLE_TRACE(PROBE_BEGIN, this, block_size, 0);
         while (!place_values.empty()) {
             place_values_new.clear();
             for (auto it : place_values) {
                 auto place_value = std::get<1>(it);
                 auto index = std::get<0>(it);
-                if (place_value && buf[place_value - 1].first != keys[index]) {
+                if (place_value && buf[place_value - 1].first != column_key(column, begin + index)) {
                     place_values_new.emplace_back(index, next[place_value]);
                 } else {
                     res[index] = place_value;
@@ -173,54 +525,338 @@ public:
             }
             swap(place_values, place_values_new);
         }
-        return res;
+        HASH_TABLE_TRACE(PROBE_END, this, block_size, 0);
+    }
+
+    /// Reorder buf by bucket and rebuild the chains, so the cells of
+    /// neighbouring buckets are neighbours in buf too. Sorted probing then
+    /// reads buf nearly sequentially instead of one random line per hit.
+    /// For build sides that are complete; positions from find() change.
+    void cluster_cells() {
+        std::vector<index_t> bucket_begin(bucket_size() + 1, 0);
+        for (index_t i = 0; i < m_size; ++i) {
+            ++bucket_begin[(hash(buf[i].first) & mask()) + 1];
+        }
+        for (index_t i = 0; i < bucket_size(); ++i) {
+            bucket_begin[i + 1] += bucket_begin[i];
+        }
+        auto new_buf = static_cast<Cell*>(Allocator::alloc(buf_bytes()));
+        HASH_TABLE_TRACE(ALLOC, this, allocated_bytes() + buf_bytes(), allocated_bytes());
+        for (index_t i = 0; i < m_size; ++i) {
+            auto bucket_value = hash(buf[i].first) & mask();
+            memcpy(static_cast<void*>(&new_buf[bucket_begin[bucket_value]++]), &buf[i], sizeof(Cell));
+        }
+        Allocator::free(buf, buf_bytes());
+        buf = new_buf;
+        HASH_TABLE_TRACE(ALLOC, this, allocated_bytes(), allocated_bytes() + buf_bytes());
+        clear_hot_keys();
+        memset(first, 0, first_bytes());
+        /// the cells of a bucket are contiguous, chain them in buf order
+        for (index_t i = m_size; i > 0; --i) {
+            auto bucket_value = hash(buf[i - 1].first) & mask();
+            next[i] = first[bucket_value];
+            first[bucket_value] = i;
+        }
+    }
+
+    /// Probe blocks of at least block_size keys in bucket order, 0 turns it
+    /// off (the default). It pays off on tables far bigger than cache whose
+    /// cells were clustered, main_sorted_probe.cpp measures the crossover.
+    void set_sorted_probe(uint32_t block_size) { sorted_probe_block_size = block_size; }
+
+    /// m_find_column, but the keys are radix sorted by the high bits of
+    /// their bucket first, so consecutive probes read neighbouring first[]
+    /// lines and repeated keys run back to back. Results are written to the
+    /// original positions.
+    template <typename Column>
+    void m_find_column_sorted(const Column &column, size_t begin, uint32_t block_size, index_t* res,
+                              const uint32_t* hash_values = nullptr) {
+        static constexpr uint32_t RADIX_BITS = 8;
+        static constexpr uint32_t RADIX_PASSES = 2;
+        auto shift = degree > RADIX_BITS * RADIX_PASSES ? degree - RADIX_BITS * RADIX_PASSES : 0;
+        /// (bucket, index) pairs, sorted on bucket >> shift
+        std::vector<std::pair<uint32_t, uint32_t>> probes(block_size);
+        std::vector<std::pair<uint32_t, uint32_t>> probes_new(block_size);
+        HASH_TABLE_TRACE(HASH_BEGIN, this, block_size, 0);
+        for (uint32_t i = 0; i < block_size; ++i) {
+            auto hash_value = hash_values ? hash_values[i] : hash(column_key(column, begin + i));
+            probes[i] = {uint32_t(hash_value & mask()), i};
+        }
+        HASH_TABLE_TRACE(HASH_END, this, block_size, 0);
+        for (uint32_t pass = 0; pass < RADIX_PASSES; ++pass) {
+            auto pass_shift = shift + pass * RADIX_BITS;
+            if (pass_shift >= degree) break;
+            uint32_t count[(1 << RADIX_BITS) + 1] = {};
+            for (auto &probe : probes) {
+                ++count[((probe.first >> pass_shift) & ((1 << RADIX_BITS) - 1)) + 1];
+            }
+            for (uint32_t i = 0; i < (1 << RADIX_BITS); ++i) {
+                count[i + 1] += count[i];
+            }
+            for (auto &probe : probes) {
+                probes_new[count[(probe.first >> pass_shift) & ((1 << RADIX_BITS) - 1)]++] = probe;
+            }
+            swap(probes, probes_new);
+        }
+        /// first[] of later probes is close by now, so their heads can be
+        /// read early to prefetch the random buf line
+        static constexpr uint32_t PREFETCH_DISTANCE = 16;
+        HASH_TABLE_TRACE(PROBE_BEGIN, this, block_size, 0);
+        for (uint32_t i = 0; i < block_size; ++i) {
+            if (i + PREFETCH_DISTANCE < block_size) {
+                auto head = first[probes[i + PREFETCH_DISTANCE].first];
+                if (head) __builtin_prefetch(&buf[head - 1]);
+            }
+            auto &probe = probes[i];
+            auto place_value = first[probe.first];
+            const auto &key = column_key(column, begin + probe.second);
+            while (place_value && buf[place_value - 1].first != key) {
+                ++collision_num;
+                place_value = next[place_value];
+            }
+            res[probe.second] = place_value;
+        }
+        HASH_TABLE_TRACE(PROBE_END, this, block_size, 0);
+    }
+
+    /// remove key and all its RowRefs. The last cell moves into the freed
+    /// slot so buf stays dense and its memory is reused by the next insert.
+    bool erase(const key_t &key) {
+        auto bucket_value = hash(key) & mask();
+        index_t prev_value = 0;
+        auto place_value = first[bucket_value];
+        while (place_value && buf[place_value - 1].first != key) {
+            prev_value = place_value;
+            place_value = next[place_value];
+        }
+        if (!place_value) return false;
+
+        if (prev_value) {
+            next[prev_value] = next[place_value];
+        } else {
+            first[bucket_value] = next[place_value];
+        }
+        destroy_mapped(buf[place_value - 1].second);
+        move_last_cell(place_value);
+        return true;
+    }
+
+    /// remove a single RowRef of key, the key goes away with its last RowRef
+    bool erase(const key_t &key, const RowRef &row_ref) {
+        auto place_value = find(key);
+        if (!place_value) return false;
+        auto &row_refs = buf[place_value - 1].second;
+        if (!row_refs.erase(row_ref)) return false;
+        if (!row_refs.get_row_count()) {
+            erase(key);
+        }
+        return true;
+    }
+
+    /// erase with block, returns how many keys were removed
+    uint32_t m_erase(key_t* keys, uint32_t block_size) {
+        uint32_t erased = 0;
+        for (auto i = 0; i < block_size; ++i) {
+            erased += erase(keys[i]);
+        }
+        return erased;
+    }
+
+    /// position of key, and whether it was added with a value initialized
+    /// Mapped that the caller fills in
+    std::pair<index_t, bool> emplace(const key_t &key) {
+        return emplace(key, hash(key));
     }
 
-    RowRefList* get(uint32_t pos) {
+    Mapped* get(index_t pos) {
         return &buf[pos].second;
     }
 
+    /// cells are dense in buf, find() position p is begin() + p - 1
+    Cell* begin() { return buf; }
+    Cell* end() { return buf + m_size; }
+
+    /// add a cell whose key is known to be absent, its RowRefList batches move along
+    void insert_unique(Cell &&cell) {
+        new (&buf[m_size]) Cell(std::move(cell));
+        ++m_size;
+        auto bucket_value = hash(buf[m_size - 1].first) & mask();
+        next[m_size] = first[bucket_value];
+        first[bucket_value] = m_size;
+        if (is_full()) {
+            resize();
+        }
+    }
+
+    /// move every cell of other into this table, other is left empty.
+    /// Keys present in both get other's RowRefList spliced into theirs.
+    void merge(BasicHashTable &other) {
+        static_assert(std::is_same<Mapped, RowRefList>::value, "merge splices RowRefLists");
+        for (auto &cell : other) {
+            auto [place_value, inserted] = emplace(lookup_key(cell.first));
+            auto row_refs = &buf[place_value - 1].second;
+            if (inserted) {
+                *row_refs = cell.second;
+            } else {
+                row_refs->splice(cell.second);
+            }
+        }
+        other.release_cells();
+    }
+
+    /// forget all cells without freeing their batches, once they moved to another table
+    void release_cells() {
+        clear_hot_keys();
+        m_size = 0;
+        std::fill(first, first + bucket_size(), 0);
+    }
+
+    index_t size() const { return m_size; }
+
+    /// buf keeps its cell indexes, so it is grown in place by the allocator
+    /// (mremap for MmapAllocator), first/next are rebuilt from scratch
     void resize() {
+        auto old_buf_bytes = buf_bytes();
+#ifdef HASH_TABLE_TRACING
+        auto old_allocated_bytes = allocated_bytes();
+#endif
+        Allocator::free(first, first_bytes());
+        Allocator::free(next, next_bytes());
         degree = degree + (degree > 23 ? 1 : 2);
-        auto temp_buf = new Cell[buf_size()];
-        auto temp_first = new uint32_t[bucket_size()];
-        auto temp_next = new uint32_t[buf_size() + 1];
-        std::memcpy(temp_buf, buf, sizeof(Cell) * m_size);
-        delete buf;
-        delete first;
-        delete next;
-        buf = temp_buf;
-        first = temp_first;
-        next = temp_next;
-        for (auto i = 0; i < m_size; i++) {
-            auto hash_value = hash(buf[i].first);
-            auto bucket_value = hash_value & mask();
-            next[i + 1] = first[bucket_value];
-            first[bucket_value] = i + 1;
+        HASH_TABLE_TRACE(RESIZE_BEGIN, this, m_size, buf_size());
+        buf = static_cast<Cell*>(Allocator::realloc(buf, old_buf_bytes, buf_bytes()));
+        first = static_cast<index_t*>(Allocator::alloc(first_bytes()));
+        next = static_cast<index_t*>(Allocator::alloc(next_bytes()));
+        HASH_TABLE_TRACE(ALLOC, this, allocated_bytes(), old_allocated_bytes);
+        if (resize_threads > 1 && m_size >= PARALLEL_RESIZE_THRESHOLD) {
+            rehash_parallel();
+        } else {
+            for (index_t i = 0; i < m_size; i++) {
+                auto hash_value = hash(buf[i].first);
+                auto bucket_value = hash_value & mask();
+                next[i + 1] = first[bucket_value];
+                first[bucket_value] = i + 1;
+            }
         }
+        HASH_TABLE_TRACE(RESIZE_END, this, m_size, buf_size());
     }
+
+    /// Rehash on num_threads threads once the table holds at least
+    /// PARALLEL_RESIZE_THRESHOLD cells, 1 (the default) keeps it on the
+    /// inserting thread. Chains are then linked in no particular order.
+    /// The inserting thread takes part, the other num_threads - 1 start at
+    /// the first parallel resize and serve every later one.
+    void set_resize_threads(uint32_t num_threads) { resize_threads = num_threads; }
     uint32_t next_num() const { return collision_num; }
-    uint32_t hash(const key_t &key) const {
-        
-        return XXHash32::hash(key.data(), 64, 0);
+    template <typename T>
+    uint32_t hash(const T &key) const {
+        return hash_key(key);
     }
-    uint32_t buf_size() {
-        return (1 << degree);
+    index_t buf_size() {
+        return index_t(1) << degree;
     }
-    uint32_t bucket_size() {
-        return (1 << (degree));
+    /// hashes are 32 bit, past 2^32 cells the chains get longer instead
+    index_t bucket_size() {
+        return index_t(1) << std::min<uint32_t>(degree, 32);
     }
-    uint32_t mask() {
+    index_t mask() {
         return bucket_size() - 1;
     }
     bool is_full() {
         return m_size >= buf_size();
     }
+    size_t buf_bytes() { return sizeof(Cell) * buf_size(); }
+    /// bytes of buf, first and next together
+    size_t allocated_bytes() { return buf_bytes() + first_bytes() + next_bytes(); }
+    size_t first_bytes() { return sizeof(index_t) * bucket_size(); }
+    size_t next_bytes() { return sizeof(index_t) * (buf_size() + 1); }
 private:
+    static const key_t &lookup_key(const key_t &key) { return key; }
+
+    template <size_t N>
+    static String lookup_key(const InlineString<N> &key) { return key.to_string(); }
+
+    static void destroy_mapped(Mapped &mapped) {
+        if constexpr (std::is_same<Mapped, RowRefList>::value) {
+            mapped.clear();
+        }
+    }
+
+    struct HotKey {
+        uint32_t hash_value;
+        index_t place_value;
+    };
+    static constexpr uint32_t HOT_KEYS = 64;
+
+    /// the hot key cache is indexed by the top hash bits, buckets use the low ones
+    static uint32_t hot_slot(uint32_t hash_value) { return hash_value >> 26; }
+
+    /// position of key from the hot key cache, 0 when it is not cached
+    index_t find_hot(const key_t &key, uint32_t hash_value) {
+        auto &hot_key = hot_keys[hot_slot(hash_value)];
+        if (hot_key.place_value && hot_key.hash_value == hash_value && buf[hot_key.place_value - 1].first == key) {
+            return hot_key.place_value;
+        }
+        return 0;
+    }
+
+    /// cells moved, cached positions may point at other keys or past m_size
+    void clear_hot_keys() { memset(hot_keys, 0, sizeof(hot_keys)); }
+
+    static constexpr index_t PARALLEL_RESIZE_THRESHOLD = 1 << 20;
+
+    /// each thread hashes a contiguous range of buf and pushes its cells on
+    /// the head of their chains with an atomic exchange on first[]; every
+    /// old head is handed out once, so each chain still links all its cells
+    void rehash_parallel() {
+        auto rehash_range = [this](index_t begin, index_t end) {
+            for (auto i = begin; i < end; ++i) {
+                auto bucket_value = hash(buf[i].first) & mask();
+                next[i + 1] = __atomic_exchange_n(&first[bucket_value], i + 1, __ATOMIC_RELAXED);
+            }
+        };
+        if (!resize_workers || resize_workers->size() != resize_threads - 1) {
+            delete resize_workers;
+            resize_workers = new ResizeWorkers(resize_threads - 1);
+        }
+        auto range_size = (m_size + resize_threads - 1) / resize_threads;
+        resize_workers->run((m_size + range_size - 1) / range_size, [&](uint32_t range) {
+            auto begin = range * range_size;
+            rehash_range(begin, std::min<index_t>(begin + range_size, m_size));
+        });
+    }
+
+    /// relink the last cell of buf to place_value, whose chain link is already gone
+    void move_last_cell(index_t place_value) {
+        clear_hot_keys();
+        if (place_value != m_size) {
+            auto bucket_value = hash(buf[m_size - 1].first) & mask();
+            auto link = &first[bucket_value];
+            while (*link != m_size) {
+                link = &next[*link];
+            }
+            *link = place_value;
+            next[place_value] = next[m_size];
+            buf[place_value - 1] = buf[m_size - 1];
+        }
+        --m_size;
+    }
+
     uint32_t degree;
-    uint32_t m_size;
+    index_t m_size;
     Cell* buf;
-    uint32_t* first;
-    uint32_t* next;
+    index_t* first;
+    index_t* next;
     uint32_t collision_num{0};
-};
\ No newline at end of file
+    uint32_t sorted_probe_block_size{0};
+    uint32_t resize_threads{1};
+    ResizeWorkers* resize_workers = nullptr;
+    HotKey hot_keys[HOT_KEYS] = {};
+};
+
+using HashTable = BasicHashTable<String>;
+using InlineKeyHashTable = BasicHashTable<String, InlineString<24>>;
+using UInt64HashTable = BasicHashTable<uint64_t>;
+using UInt128HashTable = BasicHashTable<UInt128>;
+using UInt256HashTable = BasicHashTable<UInt256>;
+using HugePageHashTable = BasicHashTable<String, String, MmapAllocator<HugePages::TRANSPARENT>>;
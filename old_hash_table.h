@@ -12,7 +12,7 @@
 struct RowRef {
     using SizeT = uint32_t;
     SizeT row_num = 0;
-    uint8_t block_offset;
+    uint8_t block_offset = 0;
 
     RowRef() {}
     RowRef(size_t row_num_count, uint8_t block_offset_)
@@ -76,24 +76,18 @@ public:
     ~HashTable() {
         m_size = 0;
         if (buf) {
-            delete buf;
+            delete[] buf;
             buf = nullptr;
         }
     }
     void insert(key_t key, RowRef && value) {
-        {      
-            auto place_value = find(key);
-            if (place_value != -1) {
-                auto block = &buf[place_value];
-                block->second.insert(std::move(value));
-                return;
-            }
-        }
+        /// one hash and one probe sequence, a miss stops on the empty cell to fill
         auto hash_value = hash(key);
-
         auto [is_find, place_value] = find_cell(key, hash_value, place(hash_value));
-        auto it = &buf[place_value];
-        assert(is_find == false);
+        if (is_find) {
+            buf[place_value].second.insert(std::move(value));
+            return;
+        }
         new (&buf[place_value]) Cell(key, RowRefList(value.row_num, value.block_offset));
         ++m_size;
         if (is_full()) {
@@ -129,10 +123,10 @@ public:
         auto new_buf = new Cell[buf_size()];
         buf = new_buf;
         for (auto i = 0; i < old_size; ++i) {
-            if (!is_zero(i))
-                reinsert(new_buf, i);
+            if (!is_zero(old_buf[i]))
+                reinsert(old_buf, i);
         }
-        delete old_buf;
+        delete[] old_buf;
     }
     void reinsert(Cell* old_buf, uint32_t pos) {
         auto hash_value = hash(old_buf[pos].first); 
@@ -142,10 +136,10 @@ public:
         memcpy(static_cast<void*>(&buf[new_place_value]), &old_buf[pos], sizeof(old_buf[pos]));
     }
     bool is_zero(uint32_t place_value) const {
-        if (!buf[place_value].second.row_num && !buf[place_value].second.block_offset) {
-            return true;
-        }
-        return false;
+        return is_zero(buf[place_value]);
+    }
+    static bool is_zero(const Cell &cell) {
+        return !cell.second.row_num && !cell.second.block_offset;
     }
     uint32_t next_num() const {return collision_num; }
     uint32_t hash(const key_t &key) const {
@@ -0,0 +1,292 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include "String.h"
+#include "new_hash_table.h"
+
+/// B+-tree over String keys for point, prefix and range lookups, with the
+/// same RowRefList payloads as HashTable. Keys are not copied, as in
+/// HashTable the caller keeps their memory alive.
+///
+/// Nodes are prefix compressed: the bytes all keys of a node share are
+/// stored once (as the node's prefix_len into its first key), and each key
+/// gets a 4 byte head, the big endian bytes right after the prefix. A node
+/// is searched on the contiguous heads and only keys whose head ties with
+/// the probe are compared in full.
+class OrderedIndex {
+public:
+    using key_t = String;
+    static constexpr uint32_t NODE_SIZE = 32;
+
+    OrderedIndex() { root = new Leaf(); }
+    OrderedIndex(const OrderedIndex&) = delete;
+    OrderedIndex& operator=(const OrderedIndex&) = delete;
+    ~OrderedIndex() { destroy(root); }
+
+    void insert(const key_t &key, RowRef && value) {
+        Node* sibling = nullptr;
+        key_t separator;
+        insert(root, key, std::move(value), sibling, separator);
+        if (sibling) {
+            auto new_root = new Inner();
+            new_root->size = 1;
+            new_root->keys[0] = separator;
+            new_root->children[0] = root;
+            new_root->children[1] = sibling;
+            new_root->update_heads();
+            root = new_root;
+            ++height;
+        }
+    }
+
+    /// insert with block
+    void m_insert(key_t* keys, RowRef* values, unsigned int block_size) {
+        for (uint32_t i = 0; i < block_size; ++i) {
+            insert(keys[i], std::move(values[i]));
+        }
+    }
+
+    /// RowRefList of key, nullptr if not found
+    RowRefList* find(const key_t &key) {
+        auto leaf = find_leaf(key);
+        auto pos = leaf->lower_bound(key);
+        if (pos == leaf->size || leaf->keys[pos] != key) return nullptr;
+        return &leaf->values[pos];
+    }
+
+    /// calls func(key, row_refs) for every key in [begin, end), in order
+    template <typename Func>
+    void range(const key_t &begin, const key_t &end, Func && func) {
+        auto leaf = find_leaf(begin);
+        for (auto pos = leaf->lower_bound(begin); leaf; leaf = leaf->next_leaf, pos = 0) {
+            for (; pos < leaf->size; ++pos) {
+                if (leaf->keys[pos].compare(end) >= 0) return;
+                func(leaf->keys[pos], leaf->values[pos]);
+            }
+        }
+    }
+
+    /// calls func(key, row_refs) for every key starting with prefix, in order
+    template <typename Func>
+    void prefix(const key_t &prefix, Func && func) {
+        auto leaf = find_leaf(prefix);
+        for (auto pos = leaf->lower_bound(prefix); leaf; leaf = leaf->next_leaf, pos = 0) {
+            for (; pos < leaf->size; ++pos) {
+                if (!leaf->keys[pos].starts_with(prefix)) return;
+                func(leaf->keys[pos], leaf->values[pos]);
+            }
+        }
+    }
+
+    /// calls func(key, row_refs) for every key, in order
+    template <typename Func>
+    void for_each(Func && func) {
+        auto node = root;
+        for (uint32_t level = 0; level < height; ++level) {
+            node = static_cast<Inner*>(node)->children[0];
+        }
+        for (auto leaf = static_cast<Leaf*>(node); leaf; leaf = leaf->next_leaf) {
+            for (uint32_t pos = 0; pos < leaf->size; ++pos) {
+                func(leaf->keys[pos], leaf->values[pos]);
+            }
+        }
+    }
+
+    uint32_t size() const { return m_size; }
+
+private:
+    struct Node {
+        uint32_t size = 0;
+        uint32_t prefix_len = 0;
+        uint32_t heads[NODE_SIZE];
+        key_t keys[NODE_SIZE];
+
+        /// the 4 bytes of key after the prefix, zero padded; a smaller head
+        /// means a smaller key, equal heads need a full compare
+        uint32_t head(const key_t &key) const {
+            uint32_t res = 0;
+            for (uint32_t i = 0; i < 4; ++i) {
+                res <<= 8;
+                if (prefix_len + i < key.size()) res |= uint8_t(key[prefix_len + i]);
+            }
+            return res;
+        }
+
+        /// recompute the prefix and heads after keys changed
+        void update_heads() {
+            prefix_len = 0;
+            if (size > 1) {
+                auto &first = keys[0];
+                auto &last = keys[size - 1];
+                auto len = std::min(first.size(), last.size());
+                while (prefix_len < len && first[prefix_len] == last[prefix_len]) {
+                    ++prefix_len;
+                }
+            }
+            for (uint32_t i = 0; i < size; ++i) {
+                heads[i] = head(keys[i]);
+            }
+        }
+
+        /// -1, 0 or 1 as key sorts before, within or after the node prefix
+        int compare_prefix(const key_t &key) const {
+            if (!size || !prefix_len) return 0;
+            auto len = std::min<size_t>(key.size(), prefix_len);
+            auto res = memcmp(key.data(), keys[0].data(), len);
+            if (res) return res < 0 ? -1 : 1;
+            return key.size() < prefix_len ? -1 : 0;
+        }
+
+        /// first position whose key is >= key (upper: > key)
+        template <bool upper>
+        uint32_t search(const key_t &key) const {
+            auto prefix_res = compare_prefix(key);
+            if (prefix_res) return prefix_res < 0 ? 0 : size;
+            auto key_head = head(key);
+            uint32_t lo = 0, hi = size;
+            while (lo < hi) {
+                auto mid = (lo + hi) / 2;
+                bool before = heads[mid] < key_head;
+                if (heads[mid] == key_head) {
+                    auto res = keys[mid].compare(key);
+                    before = upper ? res <= 0 : res < 0;
+                }
+                if (before) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
+            }
+            return lo;
+        }
+
+        uint32_t lower_bound(const key_t &key) const { return search<false>(key); }
+        uint32_t upper_bound(const key_t &key) const { return search<true>(key); }
+    };
+
+    struct Leaf : Node {
+        RowRefList values[NODE_SIZE];
+        Leaf* next_leaf = nullptr;
+    };
+
+    /// children[i] holds the keys in [keys[i - 1], keys[i])
+    struct Inner : Node {
+        Node* children[NODE_SIZE + 1];
+    };
+
+    Leaf* find_leaf(const key_t &key) const {
+        auto node = root;
+        for (uint32_t level = 0; level < height; ++level) {
+            auto inner = static_cast<Inner*>(node);
+            node = inner->children[inner->upper_bound(key)];
+        }
+        return static_cast<Leaf*>(node);
+    }
+
+    /// insert into the subtree of node at level; a full node is split and
+    /// its new right sibling and their separator handed back to the parent
+    void insert(Node* node, const key_t &key, RowRef && value, Node* &sibling, key_t &separator, uint32_t level = 0) {
+        if (level == height) {
+            insert_leaf(static_cast<Leaf*>(node), key, std::move(value), sibling, separator);
+            return;
+        }
+        auto inner = static_cast<Inner*>(node);
+        auto pos = inner->upper_bound(key);
+        Node* child_sibling = nullptr;
+        key_t child_separator;
+        insert(inner->children[pos], key, std::move(value), child_sibling, child_separator, level + 1);
+        if (!child_sibling) return;
+
+        if (inner->size == NODE_SIZE) {
+            /// the middle separator moves up, the right half goes to the sibling
+            auto right = new Inner();
+            auto mid = NODE_SIZE / 2;
+            right->size = NODE_SIZE - mid - 1;
+            std::copy(inner->keys + mid + 1, inner->keys + NODE_SIZE, right->keys);
+            std::copy(inner->children + mid + 1, inner->children + NODE_SIZE + 1, right->children);
+            separator = inner->keys[mid];
+            inner->size = mid;
+            sibling = right;
+            if (pos > mid) {
+                insert_child(right, pos - mid - 1, child_separator, child_sibling);
+            } else {
+                insert_child(inner, pos, child_separator, child_sibling);
+            }
+            inner->update_heads();
+            right->update_heads();
+            return;
+        }
+        insert_child(inner, pos, child_separator, child_sibling);
+        inner->update_heads();
+    }
+
+    static void insert_child(Inner* inner, uint32_t pos, const key_t &key, Node* child) {
+        std::copy_backward(inner->keys + pos, inner->keys + inner->size, inner->keys + inner->size + 1);
+        std::copy_backward(inner->children + pos + 1, inner->children + inner->size + 1,
+                           inner->children + inner->size + 2);
+        inner->keys[pos] = key;
+        inner->children[pos + 1] = child;
+        ++inner->size;
+    }
+
+    void insert_leaf(Leaf* leaf, const key_t &key, RowRef && value, Node* &sibling, key_t &separator) {
+        auto left = leaf;
+        auto pos = leaf->lower_bound(key);
+        if (pos < leaf->size && leaf->keys[pos] == key) {
+            leaf->values[pos].insert(std::move(value));
+            return;
+        }
+        ++m_size;
+        if (leaf->size == NODE_SIZE) {
+            auto right = new Leaf();
+            auto mid = NODE_SIZE / 2;
+            right->size = NODE_SIZE - mid;
+            std::copy(leaf->keys + mid, leaf->keys + NODE_SIZE, right->keys);
+            /// RowRefLists move with their batches, as cells do on resize
+            memcpy(static_cast<void*>(right->values), leaf->values + mid, sizeof(RowRefList) * right->size);
+            leaf->size = mid;
+            right->next_leaf = leaf->next_leaf;
+            leaf->next_leaf = right;
+            sibling = right;
+            if (pos >= mid) {
+                pos -= mid;
+                leaf = right;
+            }
+        }
+        std::copy_backward(leaf->keys + pos, leaf->keys + leaf->size, leaf->keys + leaf->size + 1);
+        memmove(static_cast<void*>(leaf->values + pos + 1), leaf->values + pos, sizeof(RowRefList) * (leaf->size - pos));
+        leaf->keys[pos] = key;
+        new (&leaf->values[pos]) RowRefList(value.row_num, value.block_offset);
+        ++leaf->size;
+        left->update_heads();
+        if (sibling) {
+            /// set after the insert, the new key may be the first of the right leaf
+            auto right = static_cast<Leaf*>(sibling);
+            separator = right->keys[0];
+            right->update_heads();
+        }
+    }
+
+    void destroy(Node* node, uint32_t level = 0) {
+        if (level == height) {
+            auto leaf = static_cast<Leaf*>(node);
+            for (uint32_t i = 0; i < leaf->size; ++i) {
+                leaf->values[i].clear();
+            }
+            delete leaf;
+            return;
+        }
+        auto inner = static_cast<Inner*>(node);
+        for (uint32_t i = 0; i <= inner->size; ++i) {
+            destroy(inner->children[i], level + 1);
+        }
+        delete inner;
+    }
+
+    Node* root;
+    uint32_t height = 0;
+    uint32_t m_size = 0;
+};
@@ -0,0 +1,168 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "arena.h"
+#include "column_view.h"
+
+/// Fixed size keys for joins on several small columns.
+/// KeyPacker writes a null bitmap followed by the column values into one
+/// UInt64/UInt128/UInt256, so the table hashes and compares it like an integer.
+/// Columns too wide for the key are serialized with the same layout into
+/// String keys instead.
+
+struct UInt128 {
+    uint64_t items[2] = {0, 0};
+};
+
+struct UInt256 {
+    uint64_t items[4] = {0, 0, 0, 0};
+};
+
+inline bool operator==(const UInt128 &x, const UInt128 &y) {
+    return x.items[0] == y.items[0] && x.items[1] == y.items[1];
+}
+
+inline bool operator!=(const UInt128 &x, const UInt128 &y) {
+    return !(x == y);
+}
+
+inline bool operator==(const UInt256 &x, const UInt256 &y) {
+    return x.items[0] == y.items[0] && x.items[1] == y.items[1] &&
+           x.items[2] == y.items[2] && x.items[3] == y.items[3];
+}
+
+inline bool operator!=(const UInt256 &x, const UInt256 &y) {
+    return !(x == y);
+}
+
+/// murmur3 finalizer, all 64 input bits reach every output bit
+inline uint64_t mix64(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+/// the low 32 bits of mix64, used by the mask
+inline uint32_t hash_key(uint64_t key) { return mix64(key); }
+
+inline uint32_t hash_key(uint32_t key) { return hash_key(uint64_t(key)); }
+inline uint32_t hash_key(uint16_t key) { return hash_key(uint64_t(key)); }
+inline uint32_t hash_key(uint8_t key) { return hash_key(uint64_t(key)); }
+
+/// wide keys fold their 64 bit words through mix64 before the final mix
+inline uint32_t hash_key(const UInt128 &key) {
+    return hash_key(uint64_t((key.items[0] ^ mix64(key.items[1])) * 0x9e3779b97f4a7c15ULL));
+}
+
+inline uint32_t hash_key(const UInt256 &key) {
+    uint64_t h = key.items[0];
+    for (auto i = 1; i < 4; ++i) {
+        h = (h ^ mix64(key.items[i])) * 0x9e3779b97f4a7c15ULL;
+    }
+    return hash_key(h);
+}
+
+template <typename T>
+class KeyPacker {
+public:
+    KeyPacker(std::vector<FixedColumn> columns_) : columns(std::move(columns_)) {
+        uint32_t nullable = 0;
+        for (auto &column : columns) {
+            nullable += column.null_map != nullptr;
+        }
+        null_bytes = (nullable + 7) / 8;
+        key_bytes = null_bytes;
+        for (auto &column : columns) {
+            key_bytes += column.width;
+        }
+        packed = fits(columns);
+    }
+
+    /// whether the columns and their null bits fit into T
+    static bool fits(const std::vector<FixedColumn> &columns) {
+        uint32_t nullable = 0;
+        uint32_t width = 0;
+        for (auto &column : columns) {
+            nullable += column.null_map != nullptr;
+            width += column.width;
+        }
+        return width + (nullable + 7) / 8 <= sizeof(T);
+    }
+
+    uint32_t size() const { return key_bytes; }
+
+    /// false when the columns do not fit into T, serialize() them then
+    bool is_packed() const { return packed; }
+
+    /// pack rows [begin, begin + block_size) into keys, one column at a time;
+    /// throws std::length_error when !is_packed()
+    void pack(size_t begin, uint32_t block_size, T* keys) const {
+        if (!packed) throw std::length_error("KeyPacker: columns do not fit into the packed key");
+        memset(static_cast<void*>(keys), 0, sizeof(T) * block_size);
+        write(begin, block_size, reinterpret_cast<char*>(keys), sizeof(T));
+    }
+
+    /// the bytes pack() writes, as size() byte String keys copied into
+    /// arena; works for any columns
+    void serialize(size_t begin, uint32_t block_size, String* keys, Arena &arena) const {
+        auto bytes = arena.alloc(size_t(key_bytes) * block_size, 1);
+        memset(bytes, 0, size_t(key_bytes) * block_size);
+        write(begin, block_size, bytes, key_bytes);
+        for (uint32_t i = 0; i < block_size; ++i) {
+            keys[i] = String(bytes + size_t(i) * key_bytes, key_bytes);
+        }
+    }
+
+private:
+    /// rows start stride bytes apart in bytes, which are zeroed
+    void write(size_t begin, uint32_t block_size, char* bytes, size_t stride) const {
+        uint32_t null_index = 0;
+        uint32_t offset = null_bytes;
+        for (auto &column : columns) {
+            if (column.null_map) {
+                auto null_map = column.null_map + begin;
+                for (uint32_t i = 0; i < block_size; ++i) {
+                    bytes[i * stride + null_index / 8] |= (null_map[i] != 0) << (null_index % 8);
+                }
+                ++null_index;
+            }
+            auto data = column.data + begin * column.width;
+            switch (column.width) {
+            case 1: copy_column<1>(data, block_size, bytes + offset, stride); break;
+            case 2: copy_column<2>(data, block_size, bytes + offset, stride); break;
+            case 4: copy_column<4>(data, block_size, bytes + offset, stride); break;
+            case 8: copy_column<8>(data, block_size, bytes + offset, stride); break;
+            default:
+                for (uint32_t i = 0; i < block_size; ++i) {
+                    memcpy(bytes + i * stride + offset, data + i * column.width, column.width);
+                }
+            }
+            if (column.null_map) {
+                /// NULL rows keep zero value bytes so they only differ by the null bit
+                auto null_map = column.null_map + begin;
+                for (uint32_t i = 0; i < block_size; ++i) {
+                    if (null_map[i]) memset(bytes + i * stride + offset, 0, column.width);
+                }
+            }
+            offset += column.width;
+        }
+    }
+
+    template <size_t width>
+    static void copy_column(const char* data, uint32_t block_size, char* dst, size_t stride) {
+        for (uint32_t i = 0; i < block_size; ++i) {
+            memcpy(dst + i * stride, data + i * width, width);
+        }
+    }
+
+    std::vector<FixedColumn> columns;
+    uint32_t null_bytes;
+    uint32_t key_bytes;
+    bool packed;
+};
@@ -0,0 +1,196 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "new_hash_table.h"
+#include "xxhash64.h"
+
+/// 64 bit hashes for the perfect hash build, 32 bits would already collide
+/// between some keys of a million key build side
+template <typename T>
+inline uint64_t hash_key64(const T &key, uint64_t seed) {
+    return XXHash64::hash(key.data(), key.size(), seed);
+}
+
+/// murmur3 finalizer, a bijection so integer keys never collide
+inline uint64_t hash_key64(uint64_t key, uint64_t seed) {
+    key ^= seed;
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+inline uint64_t hash_key64(uint32_t key, uint64_t seed) { return hash_key64(uint64_t(key), seed); }
+inline uint64_t hash_key64(uint16_t key, uint64_t seed) { return hash_key64(uint64_t(key), seed); }
+inline uint64_t hash_key64(uint8_t key, uint64_t seed) { return hash_key64(uint64_t(key), seed); }
+
+/// Read only table for build sides that are built once and probed many times.
+/// It is built from a finished BasicHashTable with a minimal perfect hash in
+/// the style of PTHash: keys are grouped into buckets of about 4, and each
+/// bucket gets a pilot value that sends all its keys to free slots. A probe
+/// reads the bucket's pilot and then one cell, whose 32 bit fingerprint
+/// rejects almost every missing key without touching the key itself.
+/// There are no empty cells: slots past the key count are remapped into
+/// the holes left below it.
+///
+/// find() returns position + 1, 0 when not found, as HashTable does.
+template <typename Key, typename CellKey = Key>
+class PerfectHashTable {
+public:
+    using key_t = Key;
+    using Source = BasicHashTable<Key, CellKey>;
+    using Cell = typename Source::Cell;
+    static constexpr double LOAD_FACTOR = 0.98;
+    static constexpr uint32_t KEYS_PER_BUCKET = 4;
+    static constexpr uint32_t MAX_PILOT = 1 << 16;
+
+    struct FingerprintCell {
+        uint32_t fingerprint;
+        Cell cell;
+    };
+
+    /// take over the cells of source, which is left empty
+    explicit PerfectHashTable(Source &source) : m_size(source.size()) {
+        std::vector<uint64_t> hash_values(m_size);
+        while (true) {
+            auto i = 0;
+            for (auto &cell : source) {
+                hash_values[i++] = hash_key64(cell.first, seed);
+            }
+            if (build(hash_values)) break;
+            ++seed;
+        }
+
+        cells = static_cast<FingerprintCell*>(HeapAllocator::alloc(sizeof(FingerprintCell) * std::max<uint32_t>(m_size, 1)));
+        auto i = 0;
+        for (auto &cell : source) {
+            auto &res = cells[position(hash_values[i])];
+            res.fingerprint = hash_values[i] >> 32;
+            new (&res.cell) Cell(std::move(cell));
+            ++i;
+        }
+        source.release_cells();
+    }
+    ~PerfectHashTable() {
+        for (uint32_t i = 0; i < m_size; ++i) {
+            cells[i].cell.second.clear();
+        }
+        HeapAllocator::free(cells, sizeof(FingerprintCell) * std::max<uint32_t>(m_size, 1));
+    }
+
+    uint32_t find(const key_t &key) {
+        if (!m_size) return 0;
+        auto hash_value = hash_key64(key, seed);
+        auto place_value = position(hash_value);
+        auto &res = cells[place_value];
+        if (res.fingerprint != uint32_t(hash_value >> 32) || res.cell.first != key) {
+            return 0;
+        }
+        return place_value + 1;
+    }
+
+    /// find with block
+    uint32_t* m_find(key_t* keys, uint32_t block_size) {
+        auto* res = new uint32_t[block_size];
+        for (uint32_t i = 0; i < block_size; ++i) {
+            res[i] = find(keys[i]);
+        }
+        return res;
+    }
+
+    RowRefList* get(uint32_t pos) {
+        return &cells[pos].cell.second;
+    }
+
+    uint32_t size() const { return m_size; }
+
+    /// bytes of the perfect hash itself, pilots and remap
+    size_t index_bytes() const {
+        return pilots.size() * sizeof(pilots[0]) + remap.size() * sizeof(remap[0]);
+    }
+
+private:
+    uint32_t bucket(uint64_t hash_value) const {
+        return uint32_t(hash_value) % pilots.size();
+    }
+
+    uint32_t slot(uint64_t hash_value, uint32_t pilot) const {
+        return (hash_value ^ hash_key64(uint64_t(pilot), seed)) % table_size;
+    }
+
+    uint32_t position(uint64_t hash_value) const {
+        auto res = slot(hash_value, pilots[bucket(hash_value)]);
+        return res < m_size ? res : remap[res - m_size];
+    }
+
+    /// search a pilot for every bucket, largest buckets first.
+    /// false when two keys share a hash or a bucket finds no pilot,
+    /// the caller retries with another seed.
+    bool build(const std::vector<uint64_t> &hash_values) {
+        table_size = std::max<uint32_t>(m_size / LOAD_FACTOR, m_size + 1);
+        pilots.assign(std::max<uint32_t>(m_size / KEYS_PER_BUCKET, 1), 0);
+
+        std::vector<uint32_t> bucket_begin(pilots.size() + 1, 0);
+        for (auto hash_value : hash_values) {
+            ++bucket_begin[bucket(hash_value) + 1];
+        }
+        std::partial_sum(bucket_begin.begin(), bucket_begin.end(), bucket_begin.begin());
+        std::vector<uint64_t> bucket_hashes(m_size);
+        auto fill = bucket_begin;
+        for (auto hash_value : hash_values) {
+            bucket_hashes[fill[bucket(hash_value)]++] = hash_value;
+        }
+        std::vector<uint32_t> order(pilots.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) {
+            return bucket_begin[x + 1] - bucket_begin[x] > bucket_begin[y + 1] - bucket_begin[y];
+        });
+
+        std::vector<bool> taken(table_size, false);
+        std::vector<uint32_t> slots;
+        for (auto bucket_value : order) {
+            auto begin = bucket_hashes.begin() + bucket_begin[bucket_value];
+            auto end = bucket_hashes.begin() + bucket_begin[bucket_value + 1];
+            if (begin == end) break;
+            uint32_t pilot = 0;
+            for (; pilot < MAX_PILOT; ++pilot) {
+                slots.clear();
+                for (auto it = begin; it != end; ++it) {
+                    auto res = slot(*it, pilot);
+                    if (taken[res] || std::find(slots.begin(), slots.end(), res) != slots.end()) break;
+                    slots.push_back(res);
+                }
+                if (slots.size() == size_t(end - begin)) break;
+            }
+            if (pilot == MAX_PILOT) return false;
+            pilots[bucket_value] = pilot;
+            for (auto res : slots) {
+                taken[res] = true;
+            }
+        }
+
+        /// every slot at or past m_size that got a key is sent to a hole below m_size
+        remap.assign(table_size - m_size, 0);
+        uint32_t hole = 0;
+        for (auto res = m_size; res < table_size; ++res) {
+            if (!taken[res]) continue;
+            while (taken[hole]) ++hole;
+            remap[res - m_size] = hole++;
+        }
+        return true;
+    }
+
+    uint32_t m_size;
+    uint32_t table_size = 0;
+    uint64_t seed = 0;
+    std::vector<uint16_t> pilots;
+    std::vector<uint32_t> remap;
+    FingerprintCell* cells = nullptr;
+};
@@ -0,0 +1,155 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include "String.h"
+#include "new_hash_table.h"
+#include "xxhash32.h"
+
+/// Linear probing with Robin Hood displacement.
+/// dist[i] is 0 for an empty slot and probe distance + 1 otherwise. A key is
+/// never placed behind a resident that is closer to its home slot, so a miss
+/// stops as soon as the probe distance passes the resident's. Erase shifts
+/// the following run back by one instead of leaving tombstones.
+class RobinHoodHashTable {
+public:
+    using key_t = String;
+    using Cell = std::pair<key_t, RowRefList>;
+    static constexpr uint8_t MAX_DIST = 255;
+    /// find() result for a missing key
+    static constexpr uint32_t EMPTY = UINT32_MAX;
+
+    RobinHoodHashTable(uint32_t degree_size, double max_load_factor_ = 0.875)
+            : degree(degree_size), max_load_factor(max_load_factor_) {
+        m_size = 0;
+        buf = new Cell[buf_size()];
+        dist = new uint8_t[buf_size()]();
+    }
+    ~RobinHoodHashTable() {
+        m_size = 0;
+        if (buf) {
+            for (uint32_t i = 0; i < buf_size(); ++i) {
+                if (dist[i]) buf[i].second.clear();
+            }
+            delete[] buf;
+            buf = nullptr;
+        }
+        if (dist) {
+            delete[] dist;
+            dist = nullptr;
+        }
+    }
+
+    void insert(const key_t &key, RowRef && value) {
+        auto place_value = find(key);
+        if (place_value != EMPTY) {
+            buf[place_value].second.insert(std::move(value));
+            return;
+        }
+        insert_cell(Cell(key, RowRefList(value.row_num, value.block_offset)));
+        ++m_size;
+        if (is_full()) {
+            resize();
+        }
+    }
+
+    /// position of key, EMPTY when not found
+    uint32_t find(const key_t &key) {
+        auto place_value = place(hash(key));
+        for (uint32_t d = 1; dist[place_value] >= d; ++d) {
+            if (buf[place_value].first == key) return place_value;
+            place_value = next(place_value);
+            ++collision_num;
+        }
+        return EMPTY;
+    }
+
+    /// remove key and all its RowRefs, returns false if it was not there
+    bool erase(const key_t &key) {
+        auto place_value = find(key);
+        if (place_value == EMPTY) return false;
+        buf[place_value].second.clear();
+        auto next_value = next(place_value);
+        while (dist[next_value] > 1) {
+            buf[place_value] = buf[next_value];
+            dist[place_value] = dist[next_value] - 1;
+            place_value = next_value;
+            next_value = next(next_value);
+        }
+        dist[place_value] = 0;
+        --m_size;
+        return true;
+    }
+
+    RowRefList* get(uint32_t pos) {
+        return &buf[pos].second;
+    }
+
+    void resize() {
+        auto old_size = buf_size();
+        auto old_buf = buf;
+        auto old_dist = dist;
+        degree = degree + (degree > 23 ? 1 : 2);
+        buf = new Cell[buf_size()];
+        dist = new uint8_t[buf_size()]();
+        for (uint32_t i = 0; i < old_size; ++i) {
+            if (old_dist[i]) insert_cell(std::move(old_buf[i]));
+        }
+        delete[] old_buf;
+        delete[] old_dist;
+    }
+
+    uint32_t next_num() const { return collision_num; }
+    uint32_t size() const { return m_size; }
+    uint32_t hash(const key_t &key) const {
+        return XXHash32::hash(key.data(), key.size(), 0);
+    }
+    uint32_t place(uint32_t h) const {
+        return h & mask();
+    }
+    uint32_t next(uint32_t pos) const {
+        ++pos;
+        return pos & mask();
+    }
+    uint32_t buf_size() const {
+        return (1 << degree);
+    }
+    uint32_t max_fill() const { return buf_size() * max_load_factor; }
+    uint32_t mask() const {
+        return buf_size() - 1;
+    }
+    bool is_full() const {
+        return m_size > max_fill();
+    }
+
+private:
+    /// place a cell known to be absent, displacing residents closer to home
+    void insert_cell(Cell&& cell) {
+        auto place_value = place(hash(cell.first));
+        uint8_t d = 1;
+        while (dist[place_value]) {
+            if (dist[place_value] < d) {
+                std::swap(cell, buf[place_value]);
+                std::swap(d, dist[place_value]);
+            }
+            place_value = next(place_value);
+            if (++d == MAX_DIST) {
+                /// probe distance no longer fits, grow and start over with the cell in hand
+                resize();
+                insert_cell(std::move(cell));
+                return;
+            }
+        }
+        buf[place_value] = std::move(cell);
+        dist[place_value] = d;
+    }
+
+    uint32_t degree;
+    uint32_t m_size;
+    double max_load_factor;
+    Cell* buf;
+    uint8_t* dist;
+    uint32_t collision_num{0};
+};
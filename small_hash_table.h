@@ -0,0 +1,169 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "new_hash_table.h"
+
+/// 8 byte tag of a key for the small table scan, a cheap mix instead of a
+/// hash. Equal keys have equal tags, a tag match is confirmed with a full
+/// key compare. String-like keys use their first and last 8 bytes with the
+/// size mixed in, so keys sharing a prefix still get different tags.
+template <typename T>
+inline uint64_t small_tag(const T &key) {
+    uint64_t head = 0, tail = 0;
+    auto len = std::min<size_t>(key.size(), sizeof(head));
+    memcpy(&head, key.data(), len);
+    memcpy(&tail, key.data() + key.size() - len, len);
+    return head ^ (tail * 31) ^ (uint64_t(key.size()) << 56);
+}
+
+inline uint64_t small_tag(uint64_t key) { return key; }
+inline uint64_t small_tag(uint32_t key) { return key; }
+inline uint64_t small_tag(uint16_t key) { return key; }
+inline uint64_t small_tag(uint8_t key) { return key; }
+inline uint64_t small_tag(const UInt128 &key) { return key.items[0] ^ key.items[1]; }
+inline uint64_t small_tag(const UInt256 &key) {
+    return key.items[0] ^ key.items[1] ^ key.items[2] ^ key.items[3];
+}
+
+/// Table for build sides of a handful to a few dozen keys. Up to
+/// SMALL_SIZE keys are kept inline with a one byte tag each, and a lookup
+/// compares the probe's tag against all tags with SIMD (32 per AVX2
+/// compare, 16 per SSE2 compare) instead of hashing into buckets; nothing
+/// is allocated for them.
+/// The key past SMALL_SIZE promotes the table to a BasicHashTable of
+/// 2^degree_size cells. Positions from find() are not valid across the
+/// promotion; find() returns position + 1 and 0 when not found.
+template <typename Key, typename CellKey = Key, uint32_t SMALL_SIZE = 32>
+class SmallHashTable {
+public:
+    using key_t = Key;
+    using Large = BasicHashTable<Key, CellKey>;
+    static_assert(SMALL_SIZE % 32 == 0 && SMALL_SIZE <= 64, "tags are compared 32 at a time into a 64 bit mask");
+
+    SmallHashTable(uint32_t degree_size) : degree(degree_size) {}
+    SmallHashTable(const SmallHashTable&) = delete;
+    SmallHashTable& operator=(const SmallHashTable&) = delete;
+    ~SmallHashTable() {
+        for (uint32_t i = 0; i < m_size; ++i) {
+            values[i].clear();
+        }
+        delete large;
+    }
+
+    bool is_small() const { return large == nullptr; }
+
+    void insert(const key_t &key, RowRef && value) {
+        if (large) {
+            large->insert(key, std::move(value));
+            return;
+        }
+        auto tag = fold_tag(small_tag(key));
+        auto place_value = find_small(key, tag);
+        if (place_value) {
+            values[place_value - 1].insert(std::move(value));
+            return;
+        }
+        if (m_size == SMALL_SIZE) {
+            promote();
+            large->insert(key, std::move(value));
+            return;
+        }
+        tags[m_size] = tag;
+        new (&keys[m_size]) CellKey(key);
+        new (&values[m_size]) RowRefList(value.row_num, value.block_offset);
+        ++m_size;
+    }
+
+    /// insert with block
+    void m_insert(key_t* keys_, RowRef* values_, unsigned int block_size) {
+        for (uint32_t i = 0; i < block_size; ++i) {
+            insert(keys_[i], std::move(values_[i]));
+        }
+    }
+
+    index_t find(const key_t &key) {
+        return large ? large->find(key) : find_small(key, fold_tag(small_tag(key)));
+    }
+
+    /// find with block
+    index_t* m_find(key_t* keys_, uint32_t block_size) {
+        if (large) return large->m_find(keys_, block_size);
+        auto* res = new index_t[block_size];
+        for (uint32_t i = 0; i < block_size; ++i) {
+            res[i] = find_small(keys_[i], fold_tag(small_tag(keys_[i])));
+        }
+        return res;
+    }
+
+    RowRefList* get(index_t pos) {
+        return large ? large->get(pos) : &values[pos];
+    }
+
+    index_t size() const { return large ? large->size() : m_size; }
+
+    uint32_t next_num() const { return large ? large->next_num() : 0; }
+
+private:
+    /// the tag folded to one byte, so one compare covers 16 or 32 slots
+    static uint8_t fold_tag(uint64_t tag) {
+        tag ^= tag >> 32;
+        tag ^= tag >> 16;
+        return uint8_t(tag ^ (tag >> 8));
+    }
+
+    /// bit i set when tags[i] == tag, over the used and the zeroed unused slots
+    uint64_t match_tags(uint8_t tag) const {
+        uint64_t res = 0;
+#if defined(__AVX2__)
+        auto probe = _mm256_set1_epi8(tag);
+        for (uint32_t begin = 0; begin < SMALL_SIZE; begin += 32) {
+            auto eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags + begin)), probe);
+            res |= uint64_t(uint32_t(_mm256_movemask_epi8(eq))) << begin;
+        }
+#elif defined(__SSE2__)
+        auto probe = _mm_set1_epi8(tag);
+        for (uint32_t begin = 0; begin < SMALL_SIZE; begin += 16) {
+            auto eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + begin)), probe);
+            res |= uint64_t(_mm_movemask_epi8(eq)) << begin;
+        }
+#else
+        for (uint32_t i = 0; i < SMALL_SIZE; ++i) {
+            res |= uint64_t(tags[i] == tag) << i;
+        }
+#endif
+        return res;
+    }
+
+    index_t find_small(const key_t &key, uint8_t tag) const {
+        auto matches = match_tags(tag) & ((m_size == 64 ? 0 : uint64_t(1) << m_size) - 1);
+        for (; matches; matches &= matches - 1) {
+            auto i = __builtin_ctzll(matches);
+            if (keys[i] == key) return i + 1;
+        }
+        return 0;
+    }
+
+    /// move every key and its RowRefList into a BasicHashTable
+    void promote() {
+        large = new Large(degree);
+        for (uint32_t i = 0; i < m_size; ++i) {
+            large->insert_unique(typename Large::Cell(std::move(keys[i]), values[i]));
+        }
+        m_size = 0;
+    }
+
+    uint32_t degree;
+    uint32_t m_size = 0;
+    uint8_t tags[SMALL_SIZE] = {};
+    CellKey keys[SMALL_SIZE];
+    RowRefList values[SMALL_SIZE];
+    Large* large = nullptr;
+};
@@ -0,0 +1,195 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "String.h"
+#include "arena.h"
+#include "new_hash_table.h"
+
+struct StringKey24 {
+    uint64_t items[3] = {0, 0, 0};
+};
+
+inline bool operator==(const StringKey24 &x, const StringKey24 &y) {
+    return x.items[0] == y.items[0] && x.items[1] == y.items[1] && x.items[2] == y.items[2];
+}
+
+inline bool operator!=(const StringKey24 &x, const StringKey24 &y) {
+    return !(x == y);
+}
+
+/// folds like UInt256 in packed_key.h
+inline uint32_t hash_key(const StringKey24 &key) {
+    uint64_t h = key.items[0];
+    for (auto i = 1; i < 3; ++i) {
+        h = (h ^ mix64(key.items[i])) * 0x9e3779b97f4a7c15ULL;
+    }
+    return hash_key(h);
+}
+
+/// String keyed table split by key length.
+/// Keys up to 8, 16 and 24 bytes are zero padded into UInt64, UInt128 and
+/// StringKey24 and live in their own chained tables, so they hash and compare
+/// like integers. Longer keys, and keys ending with '\0' which would be
+/// ambiguous after padding, go to a String table whose keys are copied into
+/// an arena owned by the table.
+///
+/// Positions returned by find() carry the sub-table in the top two bits,
+/// 0 still means not found and get(pos - 1) gives the RowRefList.
+class StringHashTable {
+public:
+    using key_t = String;
+    static constexpr uint32_t SUB_TABLE_SHIFT = sizeof(index_t) * 8 - 2;
+    static constexpr index_t SUB_TABLE_MASK = (index_t(1) << SUB_TABLE_SHIFT) - 1;
+
+    StringHashTable(uint32_t degree_size)
+            : table8(degree_size), table16(degree_size), table24(degree_size), table_long(degree_size) {}
+
+    void insert(const key_t &key, RowRef && value) {
+        switch (sub_table(key)) {
+        case 0: table8.insert(to_key<uint64_t>(key), std::move(value)); return;
+        case 1: table16.insert(to_key<UInt128>(key), std::move(value)); return;
+        case 2: table24.insert(to_key<StringKey24>(key), std::move(value)); return;
+        }
+        /// one probe: a new cell still points at the caller's bytes, so
+        /// its key is swapped for the arena copy, which hashes the same
+        auto [place_value, inserted] = table_long.emplace(key);
+        auto &cell = table_long.begin()[place_value - 1];
+        if (inserted) {
+            cell.first = String(arena.insert(key.data(), key.size()), key.size());
+            new (&cell.second) RowRefList(value.row_num, value.block_offset);
+        } else {
+            cell.second.insert(std::move(value));
+        }
+    }
+
+    /// insert with block: the short keys of each length go to their
+    /// sub-table as one block, long keys one by one for the arena copy
+    void m_insert(key_t* keys, RowRef* values, unsigned int block_size) {
+        Block<uint64_t> block8;
+        Block<UInt128> block16;
+        Block<StringKey24> block24;
+        for (uint32_t i = 0; i < block_size; ++i) {
+            switch (sub_table(keys[i])) {
+            case 0: block8.add(keys[i], values[i]); break;
+            case 1: block16.add(keys[i], values[i]); break;
+            case 2: block24.add(keys[i], values[i]); break;
+            default: insert(keys[i], std::move(values[i]));
+            }
+        }
+        block8.insert(table8);
+        block16.insert(table16);
+        block24.insert(table24);
+    }
+
+    index_t find(const key_t &key) {
+        index_t place_value = 0;
+        auto index = sub_table(key);
+        switch (index) {
+        case 0: place_value = table8.find(to_key<uint64_t>(key)); break;
+        case 1: place_value = table16.find(to_key<UInt128>(key)); break;
+        case 2: place_value = table24.find(to_key<StringKey24>(key)); break;
+        default: place_value = table_long.find(key);
+        }
+        return place_value ? (index_t(index) << SUB_TABLE_SHIFT) | place_value : 0;
+    }
+
+    /// find with block, one block per sub-table
+    index_t* m_find(key_t* keys, uint32_t block_size) {
+        auto* res = new index_t[block_size];
+        Block<uint64_t> block8;
+        Block<UInt128> block16;
+        Block<StringKey24> block24;
+        std::vector<uint32_t> rows_long;
+        std::vector<String> keys_long;
+        for (uint32_t i = 0; i < block_size; ++i) {
+            switch (sub_table(keys[i])) {
+            case 0: block8.add(keys[i], i); break;
+            case 1: block16.add(keys[i], i); break;
+            case 2: block24.add(keys[i], i); break;
+            default: rows_long.push_back(i); keys_long.push_back(keys[i]);
+            }
+        }
+        block8.find(table8, 0, res);
+        block16.find(table16, 1, res);
+        block24.find(table24, 2, res);
+        if (!keys_long.empty()) {
+            auto place_values = table_long.m_find(keys_long.data(), keys_long.size());
+            for (size_t i = 0; i < rows_long.size(); ++i) {
+                res[rows_long[i]] = place_values[i] ? (index_t(3) << SUB_TABLE_SHIFT) | place_values[i] : 0;
+            }
+            delete[] place_values;
+        }
+        return res;
+    }
+
+    RowRefList* get(index_t pos) {
+        auto place_value = (pos + 1) & SUB_TABLE_MASK;
+        switch ((pos + 1) >> SUB_TABLE_SHIFT) {
+        case 0: return table8.get(place_value - 1);
+        case 1: return table16.get(place_value - 1);
+        case 2: return table24.get(place_value - 1);
+        }
+        return table_long.get(place_value - 1);
+    }
+
+    index_t size() const {
+        return table8.size() + table16.size() + table24.size() + table_long.size();
+    }
+
+    uint32_t next_num() const {
+        return table8.next_num() + table16.next_num() + table24.next_num() + table_long.next_num();
+    }
+
+private:
+    /// the keys of one sub-table within a block, with their rows or values
+    template <typename T>
+    struct Block {
+        std::vector<T> keys;
+        std::vector<RowRef> values;
+        std::vector<uint32_t> rows;
+
+        void add(const key_t &key, RowRef &value) {
+            keys.push_back(to_key<T>(key));
+            values.push_back(std::move(value));
+        }
+        void add(const key_t &key, uint32_t row) {
+            keys.push_back(to_key<T>(key));
+            rows.push_back(row);
+        }
+        void insert(BasicHashTable<T> &table) {
+            if (!keys.empty()) table.m_insert(keys.data(), values.data(), keys.size());
+        }
+        void find(BasicHashTable<T> &table, uint32_t index, index_t* res) {
+            if (keys.empty()) return;
+            auto place_values = table.m_find(keys.data(), keys.size());
+            for (size_t i = 0; i < rows.size(); ++i) {
+                res[rows[i]] = place_values[i] ? (index_t(index) << SUB_TABLE_SHIFT) | place_values[i] : 0;
+            }
+            delete[] place_values;
+        }
+    };
+
+    static uint32_t sub_table(const key_t &key) {
+        auto size = key.size();
+        if (size && key.data()[size - 1] == 0) return 3;
+        if (size <= 8) return 0;
+        if (size <= 16) return 1;
+        if (size <= 24) return 2;
+        return 3;
+    }
+
+    template <typename T>
+    static T to_key(const key_t &key) {
+        T res{};
+        memcpy(static_cast<void*>(&res), key.data(), key.size());
+        return res;
+    }
+
+    BasicHashTable<uint64_t> table8;
+    BasicHashTable<UInt128> table16;
+    BasicHashTable<StringKey24> table24;
+    BasicHashTable<String> table_long;
+    Arena arena;
+};
@@ -0,0 +1,111 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+
+/// Allocators for the buf/first/next arrays of BasicHashTable.
+/// alloc() returns zeroed memory, realloc() keeps the old bytes and zeroes
+/// the grown tail, sizes passed back must be the ones used to allocate.
+/// Both throw std::bad_alloc when no memory is left.
+
+/// malloc based, realloc may grow in place
+struct HeapAllocator {
+    static void* alloc(size_t size) {
+        auto res = calloc(size, 1);
+        if (!res && size) throw std::bad_alloc();
+        return res;
+    }
+
+    static void* realloc(void* ptr, size_t old_size, size_t new_size) {
+        auto res = static_cast<char*>(::realloc(ptr, new_size));
+        if (!res && new_size) throw std::bad_alloc();
+        if (new_size > old_size) {
+            memset(res + old_size, 0, new_size - old_size);
+        }
+        return res;
+    }
+
+    static void free(void* ptr, size_t) {
+        ::free(ptr);
+    }
+};
+
+enum class HugePages {
+    NONE,
+    /// madvise(MADV_HUGEPAGE), the kernel backs the range with 2M pages when it can
+    TRANSPARENT,
+    /// MAP_HUGETLB from the reserved pool, falls back to normal pages when it is empty
+    EXPLICIT,
+};
+
+/// Arrays above MMAP_THRESHOLD are mapped directly, so growing them is a
+/// mremap() that moves page tables instead of copying the data. When mremap
+/// fails, as it does for MAP_HUGETLB mappings on older kernels, the array is
+/// mapped anew and copied.
+template <HugePages huge_pages = HugePages::TRANSPARENT>
+struct MmapAllocator {
+    static constexpr size_t MMAP_THRESHOLD = 64 << 10;
+    static constexpr size_t PAGE_SIZE = 4 << 10;
+    static constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+    static void* alloc(size_t size) {
+        if (size < MMAP_THRESHOLD) {
+            return HeapAllocator::alloc(size);
+        }
+        auto mapped_size = round_up(size);
+        void* res = MAP_FAILED;
+        if (huge_pages == HugePages::EXPLICIT) {
+            res = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+        if (res == MAP_FAILED) {
+            res = mmap(nullptr, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (res == MAP_FAILED) throw std::bad_alloc();
+            advise(res, mapped_size);
+        }
+        return res;
+    }
+
+    static void* realloc(void* ptr, size_t old_size, size_t new_size) {
+        if (old_size < MMAP_THRESHOLD && new_size < MMAP_THRESHOLD) {
+            return HeapAllocator::realloc(ptr, old_size, new_size);
+        }
+        if (old_size >= MMAP_THRESHOLD && new_size >= MMAP_THRESHOLD) {
+            auto res = mremap(ptr, round_up(old_size), round_up(new_size), MREMAP_MAYMOVE);
+            if (res != MAP_FAILED) {
+                advise(res, round_up(new_size));
+                return res;
+            }
+        }
+        auto res = static_cast<char*>(alloc(new_size));
+        memcpy(res, ptr, std::min(old_size, new_size));
+        free(ptr, old_size);
+        return res;
+    }
+
+    static void free(void* ptr, size_t size) {
+        if (size < MMAP_THRESHOLD) {
+            HeapAllocator::free(ptr, size);
+            return;
+        }
+        munmap(ptr, round_up(size));
+    }
+
+private:
+    /// explicit huge page mappings, and their fallback, are whole huge pages
+    /// so mremap/munmap sizes are the same whichever page size backs them
+    static size_t round_up(size_t size) {
+        auto align = huge_pages == HugePages::EXPLICIT ? HUGE_PAGE_SIZE : PAGE_SIZE;
+        return (size + align - 1) & ~(align - 1);
+    }
+
+    static void advise(void* ptr, size_t size) {
+#ifdef MADV_HUGEPAGE
+        if (huge_pages != HugePages::NONE) {
+            madvise(ptr, size, MADV_HUGEPAGE);
+        }
+#endif
+    }
+};
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+
+/// Phase tracing for BasicHashTable. Build with -DHASH_TABLE_TRACING and
+/// point hash_table_trace_hook at a function to receive the events below;
+/// without the flag every trace point compiles to nothing.
+/// Begin/end pairs are emitted on the thread doing the work, the hook
+/// takes its own timestamps.
+enum class TraceEvent : uint8_t {
+    RESIZE_BEGIN,  /// a = cells, b = new buf size
+    RESIZE_END,
+    HASH_BEGIN,    /// hashing a block, a = block size
+    HASH_END,
+    PROBE_BEGIN,   /// walking the chains of a block, a = block size
+    PROBE_END,
+    INSERT_BEGIN,  /// m_insert() of a block, a = block size, b = distinct keys before
+    INSERT_END,    /// a = block size, b = distinct keys after
+    ALLOC,         /// buf/first/next (re)allocated, a = bytes held after, b = before
+    FREE,          /// the table is destroyed, a = bytes held
+    BATCH_ALLOC,   /// a RowRefList batch, a = bytes, table is nullptr
+};
+
+using TraceHook = void (*)(TraceEvent event, const void* table, uint64_t a, uint64_t b);
+
+#ifdef HASH_TABLE_TRACING
+inline TraceHook hash_table_trace_hook = nullptr;
+
+#define HASH_TABLE_TRACE(event, table, a, b)                                 \
+    do {                                                                     \
+        if (auto hook = hash_table_trace_hook) {                             \
+            hook(TraceEvent::event, table, uint64_t(a), uint64_t(b));        \
+        }                                                                    \
+    } while (0)
+#else
+#define HASH_TABLE_TRACE(event, table, a, b) \
+    do {                                     \
+    } while (0)
+#endif
@@ -0,0 +1,281 @@
+#pragma once
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "new_hash_table.h"
+
+/// 256 chained tables selected by the top 8 bits of the hash.
+/// Each sub-table resizes on its own, so growth only touches 1/256th of the
+/// cells, and sub-tables can be processed by different threads.
+///
+/// Positions returned by find() carry the sub-table in the top 8 bits,
+/// 0 still means not found and get(pos - 1) gives the RowRefList.
+template <typename Key, typename CellKey = Key>
+class TwoLevelHashTable {
+public:
+    using key_t = Key;
+    using Impl = BasicHashTable<Key, CellKey>;
+    using Cell = typename Impl::Cell;
+    static constexpr uint32_t BITS_FOR_BUCKET = 8;
+    static constexpr uint32_t NUM_BUCKETS = 1 << BITS_FOR_BUCKET;
+    /// the sub-table comes from the top bits of the 32 bit hash, and goes
+    /// to the top bits of the index_t position
+    static constexpr uint32_t HASH_SHIFT = 32 - BITS_FOR_BUCKET;
+    static constexpr uint32_t POSITION_SHIFT = sizeof(index_t) * 8 - BITS_FOR_BUCKET;
+    static constexpr index_t POSITION_MASK = (index_t(1) << POSITION_SHIFT) - 1;
+
+    TwoLevelHashTable(uint32_t sub_degree = 8) {
+        for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+            impls[i] = new Impl(sub_degree);
+        }
+    }
+
+    /// take over the cells of a single level table, which is left empty
+    explicit TwoLevelHashTable(Impl &src) {
+        uint32_t sub_degree = 8;
+        while ((1u << sub_degree) < src.size() / NUM_BUCKETS * 2) {
+            ++sub_degree;
+        }
+        for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+            impls[i] = new Impl(sub_degree);
+        }
+        for (auto &cell : src) {
+            impls[bucket(hash_key(cell.first))]->insert_unique(std::move(cell));
+        }
+        src.release_cells();
+    }
+
+    TwoLevelHashTable(const TwoLevelHashTable&) = delete;
+    TwoLevelHashTable& operator=(const TwoLevelHashTable&) = delete;
+    ~TwoLevelHashTable() {
+        for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+            delete impls[i];
+        }
+    }
+
+    void insert(const key_t &key, RowRef && value) {
+        insert(key, hash_key(key), std::move(value));
+    }
+
+    /// precomputed hash, same contract as BasicHashTable
+    void insert(const key_t &key, uint32_t hash_value, RowRef && value) {
+        impls[bucket(hash_value)]->insert(key, hash_value, std::move(value));
+    }
+
+    /// insert with block
+    void m_insert(key_t* keys, RowRef* values, unsigned int block_size) {
+        for (uint32_t i = 0; i < block_size; ++i) {
+            insert(keys[i], std::move(values[i]));
+        }
+    }
+
+    void m_insert(key_t* keys, const uint32_t* hash_values, RowRef* values, unsigned int block_size) {
+        for (uint32_t i = 0; i < block_size; ++i) {
+            insert(keys[i], hash_values[i], std::move(values[i]));
+        }
+    }
+
+    index_t find(const key_t &key) {
+        return find(key, hash_key(key));
+    }
+
+    /// precomputed hash, same contract as BasicHashTable
+    index_t find(const key_t &key, uint32_t hash_value) {
+        auto bucket_value = bucket(hash_value);
+        auto place_value = impls[bucket_value]->find(key, hash_value);
+        assert(place_value <= POSITION_MASK);
+        return place_value ? (index_t(bucket_value) << POSITION_SHIFT) | place_value : 0;
+    }
+
+    /// find with block
+    index_t* m_find(key_t* keys, uint32_t block_size) {
+        auto* res = new index_t[block_size];
+        for (uint32_t i = 0; i < block_size; ++i) {
+            res[i] = find(keys[i]);
+        }
+        return res;
+    }
+
+    index_t* m_find(key_t* keys, const uint32_t* hash_values, uint32_t block_size) {
+        auto* res = new index_t[block_size];
+        for (uint32_t i = 0; i < block_size; ++i) {
+            res[i] = find(keys[i], hash_values[i]);
+        }
+        return res;
+    }
+
+    bool erase(const key_t &key) {
+        return impls[bucket(hash_key(key))]->erase(key);
+    }
+
+    RowRefList* get(index_t pos) {
+        ++pos;
+        return impls[pos >> POSITION_SHIFT]->get((pos & POSITION_MASK) - 1);
+    }
+
+    Impl& sub_table(uint32_t bucket_value) { return *impls[bucket_value]; }
+
+    /// merge other into this table sub-table by sub-table, other is left empty
+    void merge(TwoLevelHashTable &other, uint32_t num_threads = 1) {
+        merge({&other}, num_threads);
+    }
+
+    /// merge every source into this table. Sub-table b of all sources only
+    /// meets sub-table b here, so each thread owns a disjoint set of them
+    /// and no locking is needed.
+    void merge(const std::vector<TwoLevelHashTable*> &sources, uint32_t num_threads) {
+        auto merge_buckets = [&](uint32_t thread_index) {
+            for (auto bucket_value = thread_index; bucket_value < NUM_BUCKETS; bucket_value += num_threads) {
+                for (auto source : sources) {
+                    impls[bucket_value]->merge(*source->impls[bucket_value]);
+                }
+            }
+        };
+        if (num_threads <= 1) {
+            merge_buckets(0);
+            return;
+        }
+        std::vector<std::thread> threads;
+        for (uint32_t i = 0; i < num_threads; ++i) {
+            threads.emplace_back(merge_buckets, i);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    index_t size() const {
+        index_t res = 0;
+        for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+            res += impls[i]->size();
+        }
+        return res;
+    }
+
+    uint32_t next_num() const {
+        uint32_t res = 0;
+        for (uint32_t i = 0; i < NUM_BUCKETS; ++i) {
+            res += impls[i]->next_num();
+        }
+        return res;
+    }
+
+    static uint32_t bucket(uint32_t hash_value) { return hash_value >> HASH_SHIFT; }
+
+private:
+    Impl* impls[NUM_BUCKETS];
+};
+
+/// Starts as a single level table and converts to TwoLevelHashTable once it
+/// holds more than conversion_threshold keys. Positions from find() are not
+/// valid across the conversion.
+template <typename Key, typename CellKey = Key>
+class AutoTwoLevelHashTable {
+public:
+    using key_t = Key;
+    using SingleLevel = BasicHashTable<Key, CellKey>;
+    using TwoLevel = TwoLevelHashTable<Key, CellKey>;
+    static constexpr uint32_t DEFAULT_CONVERSION_THRESHOLD = 1 << 20;
+
+    AutoTwoLevelHashTable(uint32_t degree_size, uint32_t conversion_threshold_ = DEFAULT_CONVERSION_THRESHOLD)
+            : conversion_threshold(conversion_threshold_) {
+        single_level = new SingleLevel(degree_size);
+    }
+    AutoTwoLevelHashTable(const AutoTwoLevelHashTable&) = delete;
+    AutoTwoLevelHashTable& operator=(const AutoTwoLevelHashTable&) = delete;
+    ~AutoTwoLevelHashTable() {
+        delete single_level;
+        delete two_level;
+    }
+
+    bool is_two_level() const { return two_level != nullptr; }
+
+    void convert_to_two_level() {
+        if (two_level) return;
+        two_level = new TwoLevel(*single_level);
+        delete single_level;
+        single_level = nullptr;
+    }
+
+    void insert(const key_t &key, RowRef && value) {
+        if (two_level) {
+            two_level->insert(key, std::move(value));
+            return;
+        }
+        single_level->insert(key, std::move(value));
+        if (single_level->size() > conversion_threshold) {
+            convert_to_two_level();
+        }
+    }
+
+    /// insert with block
+    void m_insert(key_t* keys, RowRef* values, unsigned int block_size) {
+        if (two_level) {
+            two_level->m_insert(keys, values, block_size);
+            return;
+        }
+        single_level->m_insert(keys, values, block_size);
+        if (single_level->size() > conversion_threshold) {
+            convert_to_two_level();
+        }
+    }
+
+    index_t find(const key_t &key) {
+        return two_level ? two_level->find(key) : single_level->find(key);
+    }
+
+    /// find with block
+    index_t* m_find(key_t* keys, uint32_t block_size) {
+        return two_level ? two_level->m_find(keys, block_size) : single_level->m_find(keys, block_size);
+    }
+
+    bool erase(const key_t &key) {
+        return two_level ? two_level->erase(key) : single_level->erase(key);
+    }
+
+    RowRefList* get(index_t pos) {
+        return two_level ? two_level->get(pos) : single_level->get(pos);
+    }
+
+    index_t size() const {
+        return two_level ? two_level->size() : single_level->size();
+    }
+
+    uint32_t next_num() const {
+        return two_level ? two_level->next_num() : single_level->next_num();
+    }
+
+private:
+    uint32_t conversion_threshold;
+    SingleLevel* single_level = nullptr;
+    TwoLevel* two_level = nullptr;
+};
+
+/// Combine thread-local single level tables: each is converted to two
+/// level on its own thread, then the sub-tables are merged in parallel.
+/// The sources are left empty, the caller deletes the returned table.
+template <typename Key, typename CellKey>
+TwoLevelHashTable<Key, CellKey>* merge_thread_local(const std::vector<BasicHashTable<Key, CellKey>*> &tables,
+                                                    uint32_t num_threads) {
+    using TwoLevel = TwoLevelHashTable<Key, CellKey>;
+    std::vector<TwoLevel*> converted(tables.size());
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < tables.size(); ++i) {
+        threads.emplace_back([&, i] { converted[i] = new TwoLevel(*tables[i]); });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    if (converted.empty()) {
+        return new TwoLevel();
+    }
+    auto res = converted[0];
+    converted.erase(converted.begin());
+    res->merge(converted, num_threads);
+    for (auto table : converted) {
+        delete table;
+    }
+    return res;
+}